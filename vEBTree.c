@@ -1,224 +1,4505 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // pwrite, ftruncate and fsync under -std=c11, sched_getcpu and CPU_SET
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+
+// x86 SIMD kernels are compiled with per-function target attributes and
+// picked at run time, so no -mavx2 is needed; -DVEB_NO_SIMD disables them
+#if !defined(VEB_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define VEB_HAVE_X86_KERNELS 1
+#endif
 
 // van Emde Boas (vEB) Tree implementation in C/C++
 // If compiled as C++, explicit casts on malloc/calloc are required
 
+// Creation flags for vEB_create_ex (inherited by every subtree)
+#define VEB_LAZY        0x1u  // summary/clusters are allocated on first insert
+#define VEB_FREE_EMPTY  0x2u  // with VEB_LAZY: delete releases clusters that become empty
+#define VEB_BITMAP_LEAVES 0x4u // subtrees with u <= VEB_LEAF_BITS are plain bitmaps
+#define VEB_HASHED      0x8u  // with VEB_LAZY: clusters live in a hash table keyed by high(x)
+#define VEB_ARENA       0x10u // eager tree carved out of one block, freed with one free()
+#define VEB_COUNTED     0x20u // nodes keep key counts: O(1) vEB_size, fast vEB_rank/vEB_select
+#define VEB_CREATE_FLAGS (VEB_LAZY | VEB_FREE_EMPTY | VEB_BITMAP_LEAVES | VEB_HASHED | VEB_ARENA | VEB_COUNTED)
+
+// Status codes of the vEB_try_* functions (negative, so they never collide
+// with the 0/1 "changed the set" results)
+#define VEB_OK          0
+#define VEB_ERANGE      (-1)  // key outside [0, u)
+#define VEB_EINVAL      (-2)  // bad universe size or flag combination
+#define VEB_ENOMEM      (-3)  // allocation failed; the tree is unchanged
+#define VEB_EIO         (-4)  // a snapshot file could not be written, read or mapped
+#define VEB_EFORMAT     (-5)  // a file is not a snapshot of this format and version
+#define VEB_ECOMPACT    (-6)  // a store change was logged, but the automatic compaction failed
+
+// Hot-path counters of one tree, kept only when compiled with -DVEB_STATS
+// (see vEB_stats); without it the hooks compile to nothing
+typedef struct vEBStats {
+    uint64_t ops;            // member/successor/predecessor/insert/delete calls on the root
+    uint64_t levels;         // nodes visited by those calls
+    uint64_t max_depth;      // most nodes visited by a single call
+    uint64_t summary_falls;  // successor/predecessor steps that had to ask the summary
+    uint64_t minmax_hits;    // steps answered by a node's min/max without descending
+    uint64_t nodes_allocated;
+    uint64_t nodes_freed;
+    uint64_t bytes_resident; // nodes, cluster arrays and hash tables currently allocated
+} vEBStats;
+
+// vEB_estimate_memory only: the vEBCompact layout instead of a vEBNode tree
+#define VEB_COMPACT     0x200u
+
+// Node-only flag (never passed to vEB_create_ex)
+#define VEB_LEAF        0x100u // this node is a bitmap leaf
+
+// Bitmap leaf size in bits (power of two, 64..512). Leaf words share storage
+// with summary/cluster, so sizes above 128 enlarge every node.
+#ifndef VEB_LEAF_BITS
+#define VEB_LEAF_BITS 64
+#endif
+#define VEB_LEAF_WORDS (VEB_LEAF_BITS / 64)
+
 typedef struct vEBNode {
     int u;                 // universe size
     int min, max;          // minimum and maximum values in the tree
-    struct vEBNode* summary;
-    struct vEBNode** cluster;
+    union {
+        struct {
+            struct vEBNode* summary;
+            union {
+                struct vEBNode** cluster;
+                struct vEBHash* table; // VEB_HASHED: non-empty clusters only
+            };
+        };
+        uint64_t bits[VEB_LEAF_WORDS]; // VEB_LEAF: bit i set <=> key i present
+    };
     int lower_sqrt;
     int upper_sqrt;
+    int shift;             // log2(lower_sqrt): high(x) = x >> shift
+    int mask;              // lower_sqrt - 1:   low(x)  = x & mask
+    unsigned flags;        // VEB_* creation flags
+    int count;             // VEB_COUNTED: keys in the clusters (all but min)
+#ifdef VEB_STATS
+    struct vEBStatsBlock* stats; // counters of the tree this node belongs to
+#endif
 } vEBNode;
 
-// Helper: compute integer log2 (U must be power of two)
-static int log2_int(int x) {
-    return (int)round(log2(x));
+// SPARSE CLUSTERS
+// Open-addressing (linear probing) table from a cluster index to its node,
+// used by VEB_HASHED trees. The slots follow the header in one allocation,
+// and deletion shifts entries back instead of leaving tombstones, so probe
+// sequences stay short under churn. An empty table is simply NULL.
+typedef struct vEBHashSlot {
+    uint64_t key;
+    void* val;             // NULL = free slot
+} vEBHashSlot;
+
+typedef struct vEBHash {
+    uint32_t cap;          // slot count, power of two
+    uint32_t used;         // live entries (load kept <= 3/4)
+} vEBHash;
+
+#define VEB_HASH_MIN_CAP 4
+
+static vEBHashSlot* vEBHash_slots(const vEBHash* T) { return (vEBHashSlot*)(T + 1); }
+
+static uint32_t vEBHash_home(const vEBHash* T, uint64_t key) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (T->cap - 1);
 }
 
-// Create a new vEB tree of size U (must be power of two ≥2)
-// Exits on invalid U or memory allocation failure
-vEBNode* vEB_create(int U) {
-    if (U < 2) {
-        fprintf(stderr, "Error: U=%d must be ≥ 2\n", U);
-        exit(EXIT_FAILURE);
+static void* vEBHash_get(const vEBHash* T, uint64_t key) {
+    if (!T) return NULL;
+    vEBHashSlot* s = vEBHash_slots(T);
+    for (uint32_t i = vEBHash_home(T, key);; i = (i + 1) & (T->cap - 1)) {
+        if (!s[i].val) return NULL;
+        if (s[i].key == key) return s[i].val;
     }
-    if ((U & (U - 1)) != 0) {
-        fprintf(stderr, "Error: U=%d must be a power of two\n", U);
-        exit(EXIT_FAILURE);
+}
+
+static void vEBHash_place(vEBHash* T, uint64_t key, void* val) {
+    vEBHashSlot* s = vEBHash_slots(T);
+    uint32_t i = vEBHash_home(T, key);
+    while (s[i].val) i = (i + 1) & (T->cap - 1);
+    s[i].key = key;
+    s[i].val = val;
+}
+
+// Rehash into cap slots; returns 0 (table untouched) on allocation failure
+static int vEBHash_resize(vEBHash** TP, uint32_t cap) {
+    vEBHash* N = (vEBHash*)calloc(1, sizeof(vEBHash) + (size_t)cap * sizeof(vEBHashSlot));
+    if (!N) return 0;
+    N->cap = cap;
+    vEBHash* T = *TP;
+    if (T) {
+        vEBHashSlot* s = vEBHash_slots(T);
+        for (uint32_t i = 0; i < T->cap; i++) {
+            if (s[i].val) vEBHash_place(N, s[i].key, s[i].val);
+        }
+        N->used = T->used;
+        free(T);
     }
+    *TP = N;
+    return 1;
+}
 
-    // allocate node (with explicit cast for C++)
-    vEBNode* V = (vEBNode*)malloc(sizeof(vEBNode));
-    if (!V) {
-        perror("malloc vEBNode");
-        exit(EXIT_FAILURE);
+// Add a key that is not yet present; returns 0 on allocation failure
+static int vEBHash_put(vEBHash** TP, uint64_t key, void* val) {
+    vEBHash* T = *TP;
+    if (!T || (T->used + 1) * 4 > T->cap * 3) {
+        if (!vEBHash_resize(TP, T ? T->cap * 2 : VEB_HASH_MIN_CAP)) return 0;
+        T = *TP;
+    }
+    vEBHash_place(T, key, val);
+    T->used++;
+    return 1;
+}
+
+// Remove a key if present; the table is freed when its last entry goes
+static void vEBHash_remove(vEBHash** TP, uint64_t key) {
+    vEBHash* T = *TP;
+    if (!T) return;
+    vEBHashSlot* s = vEBHash_slots(T);
+    uint32_t mask = T->cap - 1, i = vEBHash_home(T, key);
+    while (s[i].key != key || !s[i].val) {
+        if (!s[i].val) return;
+        i = (i + 1) & mask;
     }
+    // backward-shift: pull later entries of the probe run into the hole
+    for (uint32_t j = (i + 1) & mask; s[j].val; j = (j + 1) & mask) {
+        uint32_t k = vEBHash_home(T, s[j].key);
+        int stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            s[i] = s[j];
+            i = j;
+        }
+    }
+    s[i].val = NULL;
+    if (--T->used == 0) {
+        free(T);
+        *TP = NULL;
+    }
+    else if (T->cap > VEB_HASH_MIN_CAP && T->used * 8 < T->cap) {
+        vEBHash_resize(TP, T->cap / 2); // shrinking is best effort
+    }
+}
+
+// Helper: compute integer log2 (U must be power of two)
+static int log2_int(int x) {
+    return __builtin_ctz((unsigned)x);
+}
+
+static int vEB_is_leaf(vEBNode* V) { return (V->flags & VEB_LEAF) != 0; }
+
+// Set up a fresh node for universe U: geometry only, no children yet
+static void vEB_init_node(vEBNode* V, int U, unsigned flags) {
     V->u = U;
     V->min = V->max = -1;
+    V->flags = flags;
+    V->count = 0;
+#ifdef VEB_STATS
+    V->stats = NULL;
+#endif
 
+    if ((flags & VEB_BITMAP_LEAVES) && U <= VEB_LEAF_BITS) {
+        // bitmap base case: no summary, no clusters
+        memset(V->bits, 0, sizeof(V->bits));
+        V->lower_sqrt = V->upper_sqrt = 0;
+        V->shift = V->mask = 0;
+        V->flags |= VEB_LEAF;
+        return;
+    }
+    V->summary = NULL;
+    V->cluster = NULL;
     if (U <= 2) {
-        V->summary = NULL;
-        V->cluster = NULL;
         V->lower_sqrt = V->upper_sqrt = 0;
+        V->shift = V->mask = 0;
     }
     else {
         int lg = log2_int(U);
         int half = lg / 2;
         V->lower_sqrt = 1 << half;
         V->upper_sqrt = 1 << (lg - half);
+        V->shift = half;
+        V->mask = V->lower_sqrt - 1;
+    }
+}
 
-        // create summary recursively
-        V->summary = vEB_create(V->upper_sqrt);
-        if (!V->summary) {
-            fprintf(stderr, "Failed to create summary (U=%d)\n", V->upper_sqrt);
-            exit(EXIT_FAILURE);
-        }
+// Bytes of the cluster array of a node with upper clusters; with
+// VEB_COUNTED a Fenwick tree of the cluster sizes follows the pointers
+static size_t vEB_cluster_array_bytes(int upper, unsigned flags) {
+    size_t slot = sizeof(vEBNode*) + ((flags & VEB_COUNTED) ? sizeof(int) : 0);
+    return (size_t)upper * slot;
+}
 
-        // allocate cluster pointer array (explicit cast for C++)
-        V->cluster = (vEBNode**)calloc(V->upper_sqrt, sizeof(vEBNode*));
-        if (!V->cluster) {
-            perror("calloc cluster array");
-            exit(EXIT_FAILURE);
-        }
+// ARENA
+// VEB_ARENA lays out the eager tree inside one block: each node is followed
+// by its summary, its cluster array and then its clusters (traversal
+// order), so creation is one malloc, vEB_free(root) is one free, and a
+// successor walk touches neighbouring memory.
+static size_t vEB_arena_bytes(int U, unsigned flags) {
+    size_t bytes = sizeof(vEBNode);
+    if (((flags & VEB_BITMAP_LEAVES) && U <= VEB_LEAF_BITS) || U <= 2) return bytes;
+    int lg = log2_int(U);
+    int half = lg / 2;
+    size_t upper = (size_t)1 << (lg - half);
+    bytes += vEB_arena_bytes(1 << (lg - half), flags);
+    bytes += vEB_cluster_array_bytes((int)upper, flags);
+    bytes += upper * vEB_arena_bytes(1 << half, flags);
+    return bytes;
+}
 
-        // eager-init each cluster
-        for (int i = 0; i < V->upper_sqrt; i++) {
-            V->cluster[i] = vEB_create(V->lower_sqrt);
-            if (!V->cluster[i]) {
-                fprintf(stderr, "Failed to create cluster[%d] (U=%d)\n", i, V->lower_sqrt);
-                exit(EXIT_FAILURE);
+static vEBNode* vEB_arena_carve(int U, unsigned flags, char** cur) {
+    vEBNode* V = (vEBNode*)*cur;
+    *cur += sizeof(vEBNode);
+    vEB_init_node(V, U, flags);
+    if (vEB_is_leaf(V) || U <= 2) return V;
+
+    V->summary = vEB_arena_carve(V->upper_sqrt, flags, cur);
+    V->cluster = (vEBNode**)*cur;
+    memset(V->cluster, 0, vEB_cluster_array_bytes(V->upper_sqrt, flags));
+    *cur += vEB_cluster_array_bytes(V->upper_sqrt, flags);
+    for (int i = 0; i < V->upper_sqrt; i++) {
+        V->cluster[i] = vEB_arena_carve(V->lower_sqrt, flags, cur);
+    }
+    return V;
+}
+
+// STATS
+// With VEB_STATS every node points at its tree's counter block, owned by
+// the root. A call on the root starts a new operation, and each node it
+// visits adds a level. Counters are bumped with relaxed atomic loads and
+// stores: counts from concurrent readers may be lost, but they never
+// race. Allocation counters cover everything made after the tree is
+// created, through vEB_alloc_child.
+// Heap bytes that belong to V itself (not its children)
+static size_t vEB_node_bytes(vEBNode* V) {
+    size_t bytes = sizeof(vEBNode);
+    if (vEB_is_leaf(V) || V->u <= 2) return bytes;
+    if (V->flags & VEB_HASHED) {
+        return V->table ? bytes + sizeof(vEBHash) + V->table->cap * sizeof(vEBHashSlot) : bytes;
+    }
+    return V->cluster ? bytes + vEB_cluster_array_bytes(V->upper_sqrt, V->flags) : bytes;
+}
+
+#ifdef VEB_STATS
+typedef struct vEBStatsBlock {
+    vEBStats s;
+    vEBNode* root;
+} vEBStatsBlock;
+
+static __thread uint64_t vEB_stats_depth; // nodes visited by this thread's current call
+
+#define VEB_STAT_ADD(V, field, n) do { \
+        if ((V)->stats) { \
+            uint64_t* c_ = &(V)->stats->s.field; \
+            __atomic_store_n(c_, __atomic_load_n(c_, __ATOMIC_RELAXED) + (uint64_t)(n), __ATOMIC_RELAXED); \
+        } \
+    } while (0)
+#define VEB_STAT_VISIT(V) vEB_stat_visit(V)
+#define VEB_STAT_BYTES(V) vEB_node_bytes(V)
+#define VEB_STAT_RESIZED(V, before) VEB_STAT_ADD(V, bytes_resident, vEB_node_bytes(V) - (before))
+
+static void vEB_stat_visit(vEBNode* V) {
+    vEBStatsBlock* S = V->stats;
+    if (!S) return;
+    if (V == S->root) {
+        vEB_stats_depth = 0;
+        VEB_STAT_ADD(V, ops, 1);
+    }
+    uint64_t d = ++vEB_stats_depth;
+    VEB_STAT_ADD(V, levels, 1);
+    if (d > __atomic_load_n(&S->s.max_depth, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&S->s.max_depth, d, __ATOMIC_RELAXED);
+    }
+}
+
+// Count every node of the subtree V as allocated (attaching it to S) or freed
+static void vEB_stats_account(vEBNode* V, vEBStatsBlock* S, int allocated) {
+    if (!V) return;
+    if (allocated) {
+        V->stats = S;
+        VEB_STAT_ADD(V, nodes_allocated, 1);
+        VEB_STAT_ADD(V, bytes_resident, vEB_node_bytes(V));
+    }
+    else {
+        VEB_STAT_ADD(V, nodes_freed, 1);
+        VEB_STAT_ADD(V, bytes_resident, 0 - vEB_node_bytes(V));
+    }
+    if (vEB_is_leaf(V) || V->u <= 2) return;
+    if (V->flags & VEB_HASHED) {
+        if (V->table) {
+            vEBHashSlot* s = vEBHash_slots(V->table);
+            for (uint32_t i = 0; i < V->table->cap; i++) {
+                if (s[i].val) vEB_stats_account((vEBNode*)s[i].val, S, allocated);
             }
         }
     }
+    else if (V->cluster) {
+        for (int i = 0; i < V->upper_sqrt; i++) vEB_stats_account(V->cluster[i], S, allocated);
+    }
+    vEB_stats_account(V->summary, S, allocated);
+}
+#else
+#define VEB_STAT_ADD(V, field, n) ((void)0)
+#define VEB_STAT_VISIT(V) ((void)0)
+#define VEB_STAT_BYTES(V) ((size_t)0)
+#define VEB_STAT_RESIZED(V, before) ((void)(before))
+#endif
+
+// Reason U/flags are rejected, or NULL if they are valid
+static const char* vEB_check_args(int U, unsigned flags) {
+    if (U < 2) return "U must be ≥ 2";
+    if ((U & (U - 1)) != 0) return "U must be a power of two";
+    if (flags & ~VEB_CREATE_FLAGS) return "unknown flags";
+    if ((flags & (VEB_FREE_EMPTY | VEB_HASHED)) && !(flags & VEB_LAZY)) {
+        return "VEB_FREE_EMPTY and VEB_HASHED require VEB_LAZY";
+    }
+    if ((flags & VEB_ARENA) && (flags & VEB_LAZY)) return "VEB_ARENA cannot be combined with VEB_LAZY";
+    if ((flags & VEB_COUNTED) && (flags & VEB_HASHED)) return "VEB_COUNTED cannot be combined with VEB_HASHED";
+    return NULL;
+}
+
+void vEB_free(vEBNode* V);
+
+// Allocate a tree for valid U/flags; NULL on allocation failure, with
+// everything allocated so far released again
+static vEBNode* vEB_alloc_tree(int U, unsigned flags) {
+    if (flags & VEB_ARENA) {
+        char* cur = (char*)malloc(vEB_arena_bytes(U, flags));
+        if (!cur) return NULL;
+        return vEB_arena_carve(U, flags, &cur);
+    }
+
+    // allocate node (with explicit cast for C++)
+    vEBNode* V = (vEBNode*)malloc(sizeof(vEBNode));
+    if (!V) return NULL;
+    vEB_init_node(V, U, flags);
+    if (vEB_is_leaf(V) || U <= 2) return V;
+
+    if (flags & VEB_HASHED) {
+        // the table is allocated with the first cluster
+        return V;
+    }
+
+    // allocate cluster pointer array (explicit cast for C++); it is
+    // NULL-filled, so a partly built tree can always go to vEB_free
+    V->cluster = (vEBNode**)calloc(1, vEB_cluster_array_bytes(V->upper_sqrt, flags));
+    if (!V->cluster) {
+        free(V);
+        return NULL;
+    }
+    if (flags & VEB_LAZY) {
+        // summary and clusters are created by vEB_insert on demand
+        return V;
+    }
+
+    // create summary and eager-init each cluster recursively
+    V->summary = vEB_alloc_tree(V->upper_sqrt, flags);
+    if (!V->summary) {
+        vEB_free(V);
+        return NULL;
+    }
+    for (int i = 0; i < V->upper_sqrt; i++) {
+        V->cluster[i] = vEB_alloc_tree(V->lower_sqrt, flags);
+        if (!V->cluster[i]) {
+            vEB_free(V);
+            return NULL;
+        }
+    }
+    return V;
+}
+
+// Give a new root its counter block (VEB_STATS); returns V, or NULL with V
+// freed if the block cannot be allocated
+static vEBNode* vEB_stats_attach(vEBNode* V) {
+#ifdef VEB_STATS
+    if (!V) return NULL;
+    vEBStatsBlock* S = (vEBStatsBlock*)calloc(1, sizeof(vEBStatsBlock));
+    if (!S) {
+        vEB_free(V);
+        return NULL;
+    }
+    S->root = V;
+    vEB_stats_account(V, S, 1);
+#endif
+    return V;
+}
+
+// Subtree of universe U for node V (a cluster or the summary), counted in
+// V's tree
+static vEBNode* vEB_alloc_child(vEBNode* V, int U) {
+    vEBNode* C = vEB_alloc_tree(U, V->flags & VEB_CREATE_FLAGS);
+#ifdef VEB_STATS
+    if (C && V->stats) vEB_stats_account(C, V->stats, 1);
+#endif
+    return C;
+}
+
+const char* vEB_strerror(int err) {
+    switch (err) {
+    case VEB_OK: return "success";
+    case VEB_ERANGE: return "key out of range";
+    case VEB_EINVAL: return "invalid universe size or flags";
+    case VEB_ENOMEM: return "out of memory";
+    case VEB_EIO: return "snapshot I/O error";
+    case VEB_EFORMAT: return "not a valid snapshot";
+    case VEB_ECOMPACT: return "change logged, compaction failed";
+    default: return "unknown error";
+    }
+}
+
+// Create a new vEB tree without printing or exiting: returns NULL and
+// stores VEB_EINVAL or VEB_ENOMEM in *err (if err is not NULL) on failure
+vEBNode* vEB_try_create(int U, unsigned flags, int* err) {
+    int status = VEB_OK;
+    vEBNode* V = NULL;
+    if (vEB_check_args(U, flags)) status = VEB_EINVAL;
+    else if (!(V = vEB_stats_attach(vEB_alloc_tree(U, flags)))) status = VEB_ENOMEM;
+    if (err) *err = status;
+    return V;
+}
+
+// Create a new vEB tree of size U (must be power of two ≥2)
+// Without VEB_LAZY every cluster is allocated up front (O(U) memory);
+// with VEB_LAZY only the root and its NULL-filled cluster array exist
+// until keys arrive, and a NULL summary/cluster counts as empty.
+// Exits on invalid U or memory allocation failure
+vEBNode* vEB_create_ex(int U, unsigned flags) {
+    const char* why = vEB_check_args(U, flags);
+    if (why) {
+        fprintf(stderr, "Error: U=%d, flags=0x%x: %s\n", U, flags, why);
+        exit(EXIT_FAILURE);
+    }
+    vEBNode* V = vEB_stats_attach(vEB_alloc_tree(U, flags));
+    if (!V) {
+        perror("malloc vEB tree");
+        exit(EXIT_FAILURE);
+    }
     return V;
 }
 
-// Helpers to split/join keys
-static int high(vEBNode* V, int x) { return x / V->lower_sqrt; }
-static int low(vEBNode* V, int x) { return x % V->lower_sqrt; }
-static int idx(vEBNode* V, int h, int l) { return h * V->lower_sqrt + l; }
+// Create a fully allocated (eager) tree
+vEBNode* vEB_create(int U) {
+    return vEB_create_ex(U, 0);
+}
+
+// Helpers to split/join keys (U is a power of two, so no division)
+static int high(vEBNode* V, int x) { return x >> V->shift; }
+static int low(vEBNode* V, int x) { return x & V->mask; }
+static int idx(vEBNode* V, int h, int l) { return (h << V->shift) | l; }
+
+// The operations below walk down with an explicit stack instead of
+// recursing. Each step goes into either one cluster or the summary (when
+// an operation needs both, the cluster part is O(1)), so the path is a
+// single chain and one frame per level is enough to finish the work on
+// the way back up.
+#define VEB_MAX_DEPTH 8    // levels below the root; a 2^30 tree needs 5
+
+enum { VEB_IN_CLUSTER, VEB_IN_SUMMARY };
+
+typedef struct vEBFrame {
+    vEBNode* V;
+    int x;                 // key the operation had at V
+    int kind;              // VEB_IN_CLUSTER / VEB_IN_SUMMARY
+} vEBFrame;
+
+// Bitmap leaves: every key (including min/max) is a bit; min/max are
+// still kept up to date so parents can read them without scanning
+
+static int leaf_member(vEBNode* V, int x) {
+    return (int)((V->bits[x >> 6] >> (x & 63)) & 1);
+}
+
+// smallest key > x in the leaf, or -1
+static int leaf_successor(vEBNode* V, int x) {
+    int i = x < 0 ? 0 : x + 1;
+    if (i >= V->u) return -1;
+    int w = i >> 6;
+    uint64_t word = V->bits[w] & (~0ULL << (i & 63));
+    for (;;) {
+        if (word) return (w << 6) + __builtin_ctzll(word);
+        if (++w >= VEB_LEAF_WORDS) return -1;
+        word = V->bits[w];
+    }
+}
+
+// largest key < x in the leaf, or -1
+static int leaf_predecessor(vEBNode* V, int x) {
+    int i = x > V->u ? V->u - 1 : x - 1;
+    if (i < 0) return -1;
+    int w = i >> 6;
+    uint64_t word = V->bits[w] & (~0ULL >> (63 - (i & 63)));
+    for (;;) {
+        if (word) return (w << 6) + 63 - __builtin_clzll(word);
+        if (--w < 0) return -1;
+        word = V->bits[w];
+    }
+}
+
+static void leaf_insert(vEBNode* V, int x) {
+    V->bits[x >> 6] |= 1ULL << (x & 63);
+    if (V->min == -1 || x < V->min) V->min = x;
+    if (x > V->max) V->max = x;
+}
+
+static void leaf_delete(vEBNode* V, int x) {
+    V->bits[x >> 6] &= ~(1ULL << (x & 63));
+    if (x == V->min) V->min = leaf_successor(V, x);
+    if (x == V->max) V->max = leaf_predecessor(V, x);
+}
+
+// Cluster h of V, or NULL if a lazy/hashed tree has not allocated it
+static vEBNode* vEB_cluster(vEBNode* V, int h) {
+    if (V->flags & VEB_HASHED) return (vEBNode*)vEBHash_get(V->table, (uint64_t)h);
+    return V->cluster[h];
+}
+
+// Cluster h of V, allocating it first in lazy/hashed trees
+// Returns NULL (V unchanged) if the allocation fails
+static vEBNode* vEB_cluster_ensure(vEBNode* V, int h) {
+    vEBNode* C = vEB_cluster(V, h);
+    if (C) return C;
+    C = vEB_alloc_child(V, V->lower_sqrt);
+    if (!C) return NULL;
+    if (V->flags & VEB_HASHED) {
+        size_t bytes = VEB_STAT_BYTES(V);
+        if (!vEBHash_put(&V->table, (uint64_t)h, C)) {
+            vEB_free(C);
+            return NULL;
+        }
+        VEB_STAT_RESIZED(V, bytes);
+    }
+    else {
+        V->cluster[h] = C;
+    }
+    return C;
+}
+
+// VEB_COUNTED: an internal node counts the keys in its clusters and keeps
+// a Fenwick tree of the cluster sizes behind its cluster pointers, so the
+// keys in clusters [0, h) are a prefix sum away. Counts change only where
+// a key enters or leaves a cluster.
+static int* vEB_fenwick(vEBNode* V) { return (int*)(V->cluster + V->upper_sqrt); }
+
+// Cluster h of V (u > 2, not a leaf) gained d keys (lost, if d < 0)
+static void vEB_count_add(vEBNode* V, int h, int d) {
+    if (!(V->flags & VEB_COUNTED) || d == 0) return;
+    V->count += d;
+    int* f = vEB_fenwick(V);
+    for (int i = h + 1; i <= V->upper_sqrt; i += i & -i) f[i - 1] += d;
+}
+
+// Keys in the subtree V; O(1) with VEB_COUNTED (clusters are not counted
+// without it, so internal nodes then read as min/max only)
+static int vEB_keys(vEBNode* V) {
+    if (!V || V->min == -1) return 0;
+    if (vEB_is_leaf(V)) {
+        int n = 0;
+        for (int w = 0; w < VEB_LEAF_WORDS; w++) n += __builtin_popcountll(V->bits[w]);
+        return n;
+    }
+    if (V->u <= 2) return V->min == V->max ? 1 : 2;
+    return 1 + V->count;
+}
 
 // Insert into empty tree
 void vEB_empty_insert(vEBNode* V, int x) {
+    if (vEB_is_leaf(V)) {
+        leaf_insert(V, x);
+        return;
+    }
     V->min = V->max = x;
 }
 
 // MEMBER (find)
 int vEB_member(vEBNode* V, int x) {
-    if (!V) return 0;
-    if (x == V->min || x == V->max) return 1;
-    if (V->u <= 2) return 0;
-    return vEB_member(V->cluster[high(V, x)], low(V, x));
+    if (!V || x < 0 || x >= V->u) return 0;
+    for (;;) {
+        VEB_STAT_VISIT(V);
+        if (x == V->min || x == V->max) {
+            VEB_STAT_ADD(V, minmax_hits, 1);
+            return 1;
+        }
+        if (vEB_is_leaf(V)) return leaf_member(V, x);
+        if (V->u <= 2) return 0;
+        vEBNode* C = vEB_cluster(V, high(V, x));
+        if (!C) return 0;
+        x = low(V, x);
+        V = C;
+    }
 }
 
-// INSERT
-void vEB_insert(vEBNode* V, int x) {
+// INSERT: returns 1 if x was added, 0 if it was already present
+// A present key is either the min/max of a node on x's path or a bit in
+// the leaf at its end, so duplicates are caught during the one descent;
+// nothing is modified above the level where that happens.
+// Every allocation on the path happens before the node it belongs to is
+// changed, so VEB_ENOMEM leaves the whole tree as it was.
+// A key that goes into an empty cluster only needs that cluster's min set,
+// so the walk continues in the summary (inserting high(x)) and the cluster
+// is filled in on the way back; otherwise it continues in the cluster.
+typedef struct vEBInsertFrame {
+    vEBNode* V;
+    int x;                 // key pushed below V (after a swap with min)
+    int old_min;           // restored on VEB_ENOMEM
+    int kind;              // VEB_IN_CLUSTER / VEB_IN_SUMMARY
+} vEBInsertFrame;
+
+static int vEB_insert_rec(vEBNode* V, int x) {
+    vEBInsertFrame path[VEB_MAX_DEPTH];
+    int depth = 0, r;
+    for (;;) {
+        VEB_STAT_VISIT(V);
+        if (vEB_is_leaf(V)) {
+            r = !leaf_member(V, x);
+            if (r) leaf_insert(V, x);
+            break;
+        }
+        if (V->min == -1) {
+            vEB_empty_insert(V, x);
+            r = 1;
+            break;
+        }
+        if (x == V->min || x == V->max) { // 이미 있으면 삽입하지 않음
+            r = 0;
+            break;
+        }
+        vEBInsertFrame* f = &path[depth];
+        f->V = V;
+        f->old_min = V->min;
+        if (x < V->min) {
+            int tmp = x; x = V->min; V->min = tmp;
+        }
+        f->x = x;
+        if (V->u <= 2) {
+            if (x > V->max) V->max = x;
+            r = 1;
+            break;
+        }
+        depth++;
+        int h = high(V, x);
+        vEBNode* C = vEB_cluster_ensure(V, h);
+        if (C && C->min == -1 && !V->summary) V->summary = vEB_alloc_child(V, V->upper_sqrt);
+        if (!C || (C->min == -1 && !V->summary)) {
+            r = VEB_ENOMEM; // an empty cluster (and summary) left behind still reads as empty
+            break;
+        }
+        if (C->min == -1) {
+            f->kind = VEB_IN_SUMMARY;
+            V = V->summary;
+            x = h;
+        }
+        else {
+            f->kind = VEB_IN_CLUSTER;
+            V = C;
+            x = low(f->V, x);
+        }
+    }
+    while (depth > 0) {
+        vEBInsertFrame* f = &path[--depth];
+        V = f->V;
+        if (r < 0) {
+            V->min = f->old_min;
+            continue;
+        }
+        if (r == 0) continue; // only reachable without a swap above
+        int h = high(V, f->x);
+        if (f->kind == VEB_IN_SUMMARY) vEB_empty_insert(vEB_cluster(V, h), low(V, f->x));
+        vEB_count_add(V, h, 1);
+        if (f->x > V->max) V->max = f->x;
+    }
+    return r;
+}
+
+// Insert x into the clusters of V (u > 2), below a min that is already set
+static int vEB_insert_below(vEBNode* V, int x) {
+    int h = high(V, x), l = low(V, x);
+    vEBNode* C = vEB_cluster_ensure(V, h);
+    if (!C) return VEB_ENOMEM;
+    if (C->min == -1) {
+        if (!V->summary) V->summary = vEB_alloc_child(V, V->upper_sqrt);
+        int r = V->summary ? vEB_insert_rec(V->summary, h) : VEB_ENOMEM;
+        if (r < 0) return r; // an empty cluster (and summary) left behind still reads as empty
+        vEB_empty_insert(C, l);
+        vEB_count_add(V, h, 1);
+        return 1;
+    }
+    int r = vEB_insert_rec(C, l);
+    if (r == 1) vEB_count_add(V, h, 1);
+    return r;
+}
+
+// Exits on memory allocation failure; see vEB_try_insert
+int vEB_insert(vEBNode* V, int x) {
     if (x < 0 || x >= V->u) {
         fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, V->u);
-        return;
+        return 0;
+    }
+    int r = vEB_insert_rec(V, x);
+    if (r == VEB_ENOMEM) {
+        perror("malloc vEB cluster");
+        exit(EXIT_FAILURE);
     }
+    return r;
+}
 
-    if (vEB_member(V, x)) return; // 이미 있으면 삽입하지 않음
+// Silent insert: 1 if x was added, 0 if present, VEB_ERANGE or VEB_ENOMEM
+int vEB_try_insert(vEBNode* V, int x) {
+    if (x < 0 || x >= V->u) return VEB_ERANGE;
+    return vEB_insert_rec(V, x);
+}
 
-    if (V->min == -1) {
-        vEB_empty_insert(V, x);
-        return;
+// SUCCESSOR / PREDECESSOR helpers (a NULL lazy cluster is empty)
+static int vEB_min(vEBNode* V) { return V ? V->min : -1; }
+static int vEB_max(vEBNode* V) { return V ? V->max : -1; }
+
+// SUCCESSOR
+int vEB_successor(vEBNode* V, int x) {
+    vEBFrame path[VEB_MAX_DEPTH];
+    int depth = 0, r;
+    for (;;) {
+        if (!V) {
+            r = -1;
+            break;
+        }
+        VEB_STAT_VISIT(V);
+        if (x < 0) {
+            r = V->min;
+            break;
+        }
+        if (x >= V->u) {
+            r = -1;
+            break;
+        }
+        if (vEB_is_leaf(V)) {
+            r = leaf_successor(V, x);
+            break;
+        }
+        if (V->u <= 2) {
+            r = (x == 0 && V->max == 1) ? 1 : -1;
+            break;
+        }
+        if (V->min != -1 && x < V->min) {
+            VEB_STAT_ADD(V, minmax_hits, 1);
+            r = V->min;
+            break;
+        }
+        int h = high(V, x), l = low(V, x);
+        vEBNode* C = vEB_cluster(V, h);
+        vEBFrame* f = &path[depth++];
+        f->V = V;
+        f->x = x;
+        int max_low = vEB_max(C);
+        if (max_low != -1 && l < max_low) {
+            f->kind = VEB_IN_CLUSTER;
+            V = C;
+            x = l;
+        }
+        else {
+            VEB_STAT_ADD(V, summary_falls, 1);
+            f->kind = VEB_IN_SUMMARY;
+            V = V->summary;
+            x = h;
+        }
     }
-    if (x < V->min) {
-        int tmp = x; x = V->min; V->min = tmp;
+    // a cluster answer is prefixed with its high part; a summary answer
+    // names the next non-empty cluster, whose min is the successor
+    while (depth > 0) {
+        vEBFrame* f = &path[--depth];
+        if (f->kind == VEB_IN_CLUSTER) r = idx(f->V, high(f->V, f->x), r);
+        else if (r != -1) r = idx(f->V, r, vEB_min(vEB_cluster(f->V, r)));
     }
-    if (V->u > 2) {
+    return r;
+}
+
+// PREDECESSOR
+int vEB_predecessor(vEBNode* V, int x) {
+    vEBFrame path[VEB_MAX_DEPTH];
+    int depth = 0, r;
+    for (;;) {
+        if (!V) {
+            r = -1;
+            break;
+        }
+        VEB_STAT_VISIT(V);
+        if (x >= V->u) {
+            r = V->max;
+            break;
+        }
+        if (x <= 0) {
+            r = -1;
+            break;
+        }
+        if (vEB_is_leaf(V)) {
+            r = leaf_predecessor(V, x);
+            break;
+        }
+        if (V->u <= 2) {
+            r = (x == 1 && V->min == 0) ? 0 : -1;
+            break;
+        }
+        if (V->max != -1 && x > V->max) {
+            VEB_STAT_ADD(V, minmax_hits, 1);
+            r = V->max;
+            break;
+        }
         int h = high(V, x), l = low(V, x);
-        if (V->cluster[h]->min == -1) {
-            vEB_insert(V->summary, h);
-            vEB_empty_insert(V->cluster[h], l);
+        vEBNode* C = vEB_cluster(V, h);
+        vEBFrame* f = &path[depth++];
+        f->V = V;
+        f->x = x;
+        int min_low = vEB_min(C);
+        if (min_low != -1 && l > min_low) {
+            f->kind = VEB_IN_CLUSTER;
+            V = C;
+            x = l;
         }
         else {
-            vEB_insert(V->cluster[h], l);
+            VEB_STAT_ADD(V, summary_falls, 1);
+            f->kind = VEB_IN_SUMMARY;
+            V = V->summary;
+            x = h;
         }
     }
-    if (x > V->max) V->max = x;
+    // no earlier cluster: the node's own min may still be below x
+    while (depth > 0) {
+        vEBFrame* f = &path[--depth];
+        if (f->kind == VEB_IN_CLUSTER) r = idx(f->V, high(f->V, f->x), r);
+        else if (r != -1) r = idx(f->V, r, vEB_max(vEB_cluster(f->V, r)));
+        else if (f->V->min != -1 && f->x > f->V->min) r = f->V->min;
+    }
+    return r;
+}
+
+// BATCHED SUCCESSOR / PREDECESSOR
+// A single query is a serial chain of cache misses (node, cluster array
+// slot, cluster, ...). The batch versions run up to VEB_BATCH_CHUNK
+// queries side by side as small state machines: every round each query
+// takes one step that reads only memory it prefetched in its previous
+// step, so the misses of different queries overlap. The recursion of
+// vEB_successor becomes an explicit per-query stack; each frame records
+// whether the query went into a cluster or into the summary, which is
+// all that is needed to build the answer on the way back up.
+#define VEB_BATCH_CHUNK 64
+
+enum { VEB_Q_VISIT, VEB_Q_LOOKUP, VEB_Q_CHOOSE, VEB_Q_RETURN, VEB_Q_DONE };
+
+typedef struct vEBQuery {
+    vEBNode* V;            // node the query is at
+    vEBNode* C;            // cluster being waited for (CHOOSE / RETURN)
+    int x;                 // key local to V, then the answer in VEB_Q_RETURN
+    int phase;             // VEB_Q_*
+    int depth;             // frames in use
+    vEBFrame frame[VEB_MAX_DEPTH];
+} vEBQuery;
+
+// One step of a successor (succ = 1) or predecessor (succ = 0) query;
+// the cases mirror vEB_successor / vEB_predecessor
+static void vEB_query_step(vEBQuery* q, int succ) {
+    vEBNode* V = q->V;
+    int x = q->x;
+    switch (q->phase) {
+    case VEB_Q_VISIT: {
+        int r;
+        if (!V) r = -1;
+        else if (succ ? x < 0 : x >= V->u) r = succ ? V->min : V->max;
+        else if (succ ? x >= V->u : x <= 0) r = -1;
+        else if (vEB_is_leaf(V)) r = succ ? leaf_successor(V, x) : leaf_predecessor(V, x);
+        else if (V->u <= 2) {
+            if (succ) r = (x == 0 && V->max == 1) ? 1 : -1;
+            else r = (x == 1 && V->min == 0) ? 0 : -1;
+        }
+        else if (succ && V->min != -1 && x < V->min) r = V->min;
+        else if (!succ && V->max != -1 && x > V->max) r = V->max;
+        else {
+            // next: the cluster pointer (hash probes are done right away)
+            if (V->flags & VEB_HASHED) {
+                q->C = vEB_cluster(V, high(V, x));
+                if (q->C) __builtin_prefetch(q->C);
+                q->phase = VEB_Q_CHOOSE;
+            }
+            else {
+                __builtin_prefetch(&V->cluster[high(V, x)]);
+                q->phase = VEB_Q_LOOKUP;
+            }
+            return;
+        }
+        q->x = r;
+        q->C = NULL;
+        q->phase = VEB_Q_RETURN;
+        return;
+    }
+    case VEB_Q_LOOKUP:
+        q->C = V->cluster[high(V, x)];
+        if (q->C) __builtin_prefetch(q->C);
+        q->phase = VEB_Q_CHOOSE;
+        return;
+    case VEB_Q_CHOOSE: {
+        int l = low(V, x);
+        int into = succ ? (vEB_max(q->C) != -1 && l < vEB_max(q->C))
+                        : (vEB_min(q->C) != -1 && l > vEB_min(q->C));
+        vEBFrame* f = &q->frame[q->depth++];
+        f->V = V;
+        f->x = x;
+        f->kind = into ? VEB_IN_CLUSTER : VEB_IN_SUMMARY;
+        q->V = into ? q->C : V->summary;
+        q->x = into ? l : high(V, x);
+        if (q->V) __builtin_prefetch(q->V);
+        q->phase = VEB_Q_VISIT;
+        return;
+    }
+    case VEB_Q_RETURN:
+        if (q->C) {
+            // the summary named cluster q->x of the top frame; its min/max
+            // (prefetched last step) completes that level
+            vEBFrame* f = &q->frame[--q->depth];
+            q->x = idx(f->V, q->x, succ ? q->C->min : q->C->max);
+            q->C = NULL;
+        }
+        while (q->depth > 0) {
+            vEBFrame* f = &q->frame[q->depth - 1];
+            if (f->kind == VEB_IN_CLUSTER) {
+                q->x = idx(f->V, high(f->V, f->x), q->x);
+            }
+            else if (q->x != -1) {
+                q->C = vEB_cluster(f->V, q->x);
+                __builtin_prefetch(q->C);
+                return;
+            }
+            else if (!succ && f->V->min != -1 && f->x > f->V->min) {
+                q->x = f->V->min;
+            }
+            q->depth--;
+        }
+        q->phase = VEB_Q_DONE;
+        return;
+    }
+}
+
+static void vEB_query_batch(vEBNode* V, const int* xs, int* out, int n, int succ) {
+    vEBQuery q[VEB_BATCH_CHUNK];
+    for (int base = 0; base < n; base += VEB_BATCH_CHUNK) {
+        int m = (n - base < VEB_BATCH_CHUNK) ? n - base : VEB_BATCH_CHUNK;
+        for (int i = 0; i < m; i++) {
+            q[i].V = V;
+            q[i].C = NULL;
+            q[i].x = xs[base + i];
+            q[i].phase = VEB_Q_VISIT;
+            q[i].depth = 0;
+        }
+        for (int live = m; live > 0;) {
+            for (int i = 0; i < m; i++) {
+                if (q[i].phase == VEB_Q_DONE) continue;
+                vEB_query_step(&q[i], succ);
+                if (q[i].phase == VEB_Q_DONE) {
+                    out[base + i] = q[i].x;
+                    live--;
+                }
+            }
+        }
+    }
+}
+
+// out[i] = vEB_successor(V, xs[i]) for i < n
+void vEB_successor_batch(vEBNode* V, const int* xs, int* out, int n) {
+    vEB_query_batch(V, xs, out, n, 1);
+}
+
+// out[i] = vEB_predecessor(V, xs[i]) for i < n
+void vEB_predecessor_batch(vEBNode* V, const int* xs, int* out, int n) {
+    vEB_query_batch(V, xs, out, n, 0);
+}
+
+// out[i] = vEB_member(V, xs[i]) for i < n, with the descents interleaved
+// like the queries above: a step at a node prefetches the cluster array
+// slot, the next one reads it and prefetches the cluster
+void vEB_member_batch(vEBNode* V, const int* xs, unsigned char* out, int n) {
+    vEBNode* node[VEB_BATCH_CHUNK];
+    vEBNode** slot[VEB_BATCH_CHUNK];
+    int key[VEB_BATCH_CHUNK];
+    for (int base = 0; base < n; base += VEB_BATCH_CHUNK) {
+        int m = (n - base < VEB_BATCH_CHUNK) ? n - base : VEB_BATCH_CHUNK;
+        int live = 0;
+        for (int i = 0; i < m; i++) {
+            key[i] = xs[base + i];
+            node[i] = (V && key[i] >= 0 && key[i] < V->u) ? V : NULL;
+            slot[i] = NULL;
+            out[base + i] = 0;
+            live += node[i] != NULL;
+        }
+        while (live > 0) {
+            for (int i = 0; i < m; i++) {
+                vEBNode* W = node[i];
+                if (!W) continue;
+                if (slot[i]) {
+                    // cluster pointer arrived: move down
+                    node[i] = *slot[i];
+                    slot[i] = NULL;
+                    if (node[i]) __builtin_prefetch(node[i]);
+                    else live--;
+                    continue;
+                }
+                int x = key[i];
+                int r = -1;
+                if (x == W->min || x == W->max) r = 1;
+                else if (vEB_is_leaf(W)) r = leaf_member(W, x);
+                else if (W->u <= 2 || W->min == -1) r = 0;
+                if (r != -1) {
+                    out[base + i] = (unsigned char)r;
+                    node[i] = NULL;
+                    live--;
+                    continue;
+                }
+                key[i] = low(W, x);
+                if (W->flags & VEB_HASHED) {
+                    node[i] = vEB_cluster(W, high(W, x));
+                    if (node[i]) __builtin_prefetch(node[i]);
+                    else live--;
+                }
+                else {
+                    slot[i] = &W->cluster[high(W, x)];
+                    __builtin_prefetch(slot[i]);
+                }
+            }
+        }
+    }
+}
+
+// RANGE ITERATION
+// vEB_for_each_in_range visits the keys of [a, b] in increasing order in
+// a single walk: at each node it reports min, then drains one cluster
+// completely before asking the summary for the next non-empty one, so a
+// scan costs one summary successor per non-empty cluster instead of a root
+// descent per key. Bitmap leaves report their keys with ctz straight from
+// the words.
+
+// Callback for vEB_for_each_in_range; a non-zero return stops the scan
+typedef int (*vEB_visit_fn)(int key, void* ctx);
+
+typedef struct vEBRangeWalk {
+    vEB_visit_fn fn;
+    void* ctx;
+    int count;             // keys reported so far
+    int stop;              // set once fn asked to stop
+} vEBRangeWalk;
+
+static void vEB_range_emit(vEBRangeWalk* W, int key) {
+    W->count++;
+    if (W->fn(key, W->ctx)) W->stop = 1;
+}
+
+// Bits a..b (inclusive) of leaf word w
+static uint64_t leaf_range_word(vEBNode* V, int w, int a, int b) {
+    uint64_t word = V->bits[w];
+    if (w == a >> 6) word &= ~0ULL << (a & 63);
+    if (w == b >> 6) word &= ~0ULL >> (63 - (b & 63));
+    return word;
+}
+
+// Report the keys of V in [a, b] (0 <= a <= b < u), offset by base
+static void vEB_range_walk(vEBNode* V, int a, int b, int base, vEBRangeWalk* W) {
+    if (!V || V->min == -1 || b < V->min || a > V->max) return;
+    if (vEB_is_leaf(V)) {
+        for (int w = a >> 6; w <= b >> 6 && !W->stop; w++) {
+            uint64_t word = leaf_range_word(V, w, a, b);
+            while (word && !W->stop) {
+                vEB_range_emit(W, base + (w << 6) + __builtin_ctzll(word));
+                word &= word - 1;
+            }
+        }
+        return;
+    }
+    if (V->min >= a) {
+        vEB_range_emit(W, base + V->min);
+        if (W->stop) return;
+    }
+    if (V->u <= 2) {
+        if (V->max != V->min && V->max <= b) vEB_range_emit(W, base + V->max);
+        return;
+    }
+    int ha = high(V, a), hb = high(V, b);
+    int h = (vEB_min(vEB_cluster(V, ha)) != -1) ? ha : vEB_successor(V->summary, ha);
+    while (h != -1 && h <= hb && !W->stop) {
+        int la = (h == ha) ? low(V, a) : 0;
+        int lb = (h == hb) ? low(V, b) : V->mask;
+        vEB_range_walk(vEB_cluster(V, h), la, lb, base + (h << V->shift), W);
+        h = vEB_successor(V->summary, h);
+    }
+}
+
+// Call fn(key, ctx) for every key in [a, b] in increasing order, until fn
+// returns non-zero. Returns the number of keys passed to fn.
+int vEB_for_each_in_range(vEBNode* V, int a, int b, vEB_visit_fn fn, void* ctx) {
+    if (!V) return 0;
+    if (a < 0) a = 0;
+    if (b >= V->u) b = V->u - 1;
+    vEBRangeWalk W = { fn, ctx, 0, 0 };
+    if (a <= b) vEB_range_walk(V, a, b, 0, &W);
+    return W.count;
+}
+
+// Number of keys of V in [a, b] (0 <= a <= b < u)
+static int vEB_count_walk(vEBNode* V, int a, int b) {
+    if (!V || V->min == -1 || b < V->min || a > V->max) return 0;
+    if (vEB_is_leaf(V)) {
+        int n = 0;
+        for (int w = a >> 6; w <= b >> 6; w++) {
+            n += __builtin_popcountll(leaf_range_word(V, w, a, b));
+        }
+        return n;
+    }
+    int n = (V->min >= a);
+    if (V->u <= 2) return n + (V->max != V->min && V->max <= b);
+    int ha = high(V, a), hb = high(V, b);
+    int h = (vEB_min(vEB_cluster(V, ha)) != -1) ? ha : vEB_successor(V->summary, ha);
+    while (h != -1 && h <= hb) {
+        int la = (h == ha) ? low(V, a) : 0;
+        int lb = (h == hb) ? low(V, b) : V->mask;
+        n += vEB_count_walk(vEB_cluster(V, h), la, lb);
+        h = vEB_successor(V->summary, h);
+    }
+    return n;
+}
+
+// Number of keys in [a, b]
+int vEB_rank(vEBNode* V, int x);
+
+int vEB_count_range(vEBNode* V, int a, int b) {
+    if (!V) return 0;
+    if (a < 0) a = 0;
+    if (b >= V->u) b = V->u - 1;
+    if (a > b) return 0;
+    if (V->flags & VEB_COUNTED) return vEB_rank(V, b + 1) - vEB_rank(V, a);
+    return vEB_count_walk(V, a, b);
+}
+
+// RANK / SELECT
+// With VEB_COUNTED both are one descent: at each node the keys in
+// clusters before high(x) come from the Fenwick prefix sum, and select
+// finds its cluster by walking down the Fenwick tree. Bitmap leaves use
+// popcount. Without VEB_COUNTED they walk the keys in order (O(n)).
+
+// Keys < x in V (0 <= x < u)
+static int vEB_rank_rec(vEBNode* V, int x) {
+    if (!V || V->min == -1 || x <= V->min) return 0;
+    VEB_STAT_VISIT(V);
+    if (x > V->max) return vEB_keys(V);
+    if (vEB_is_leaf(V)) {
+        int n = 0, w = x >> 6;
+        for (int i = 0; i < w; i++) n += __builtin_popcountll(V->bits[i]);
+        return n + __builtin_popcountll(V->bits[w] & ((1ULL << (x & 63)) - 1));
+    }
+    if (V->u <= 2) return 1;  // min < x <= max, so x = 1 and min = 0
+    int h = high(V, x), n = 1;
+    const int* f = vEB_fenwick(V);
+    for (int i = h; i > 0; i -= i & -i) n += f[i - 1];
+    return n + vEB_rank_rec(vEB_cluster(V, h), low(V, x));
+}
+
+// The k-th smallest key of V (0 <= k < keys in V)
+static int vEB_select_rec(vEBNode* V, int k) {
+    VEB_STAT_VISIT(V);
+    if (k == 0) return V->min;
+    if (vEB_is_leaf(V)) {
+        for (int w = 0; w < VEB_LEAF_WORDS; w++) {
+            uint64_t word = V->bits[w];
+            int c = __builtin_popcountll(word);
+            if (k < c) {
+                while (k--) word &= word - 1;
+                return (w << 6) + __builtin_ctzll(word);
+            }
+            k -= c;
+        }
+        return -1;
+    }
+    if (V->u <= 2) return V->max;
+    k--;  // the min is in no cluster
+    const int* f = vEB_fenwick(V);
+    int h = 0;
+    for (int step = V->upper_sqrt; step > 0; step >>= 1) {
+        if (h + step <= V->upper_sqrt && f[h + step - 1] <= k) {
+            h += step;
+            k -= f[h - 1];
+        }
+    }
+    return idx(V, h, vEB_select_rec(vEB_cluster(V, h), k));
+}
+
+typedef struct vEBSelectWalk {
+    int k;                 // keys still to skip
+    int key;
+} vEBSelectWalk;
+
+static int vEB_select_visit(int key, void* ctx) {
+    vEBSelectWalk* S = (vEBSelectWalk*)ctx;
+    if (S->k-- > 0) return 0;
+    S->key = key;
+    return 1;
+}
+
+// Number of keys in V: O(1) with VEB_COUNTED, a full walk without
+int vEB_size(vEBNode* V) {
+    if (!V) return 0;
+    if (V->flags & VEB_COUNTED) return vEB_keys(V);
+    return vEB_count_walk(V, 0, V->u - 1);
+}
+
+// RANK: number of keys < x
+int vEB_rank(vEBNode* V, int x) {
+    if (!V || x <= 0) return 0;
+    if (x >= V->u) return vEB_size(V);
+    if (!(V->flags & VEB_COUNTED)) return vEB_count_walk(V, 0, x - 1);
+    return vEB_rank_rec(V, x);
+}
+
+// SELECT: the k-th smallest key (k = 0 is the min), or -1 if k is not in
+// [0, size)
+int vEB_select(vEBNode* V, int k) {
+    if (!V || k < 0) return -1;
+    if (V->flags & VEB_COUNTED) return k < vEB_keys(V) ? vEB_select_rec(V, k) : -1;
+    vEBSelectWalk S = {k, -1};
+    vEB_for_each_in_range(V, 0, V->u - 1, vEB_select_visit, &S);
+    return S.key;
+}
+
+// Lazy trees with VEB_FREE_EMPTY: drop cluster h once it has become empty,
+// and the summary with it when no cluster is left
+static void vEB_release_cluster(vEBNode* V, int h) {
+    vEB_free(vEB_cluster(V, h));
+    if (V->flags & VEB_HASHED) {
+        size_t bytes = VEB_STAT_BYTES(V);
+        vEBHash_remove(&V->table, (uint64_t)h);
+        VEB_STAT_RESIZED(V, bytes);
+    }
+    else {
+        V->cluster[h] = NULL;
+    }
+    if (vEB_min(V->summary) == -1) {
+        vEB_free(V->summary);
+        V->summary = NULL;
+    }
+}
+
+static int vEB_delete_rec(vEBNode* V, int x);
+
+// Cluster h of V has just lost its last key
+static void vEB_cluster_emptied(vEBNode* V, int h) {
+    vEB_delete_rec(V->summary, h);
+    if (V->flags & VEB_FREE_EMPTY) vEB_release_cluster(V, h);
+}
+
+// DELETE: returns 1 if x was removed, 0 if it was not present
+// Like insert this is one descent: a missing key shows up as an empty or
+// single-key node (or a clear leaf bit) on x's path before anything has
+// been modified, except a min replacement, which only happens for keys
+// that are present.
+// A cluster that holds only x is emptied on the spot and the walk goes on
+// in the summary (deleting high(x)); otherwise it goes on in the cluster.
+static int vEB_delete_rec(vEBNode* V, int x) {
+    vEBFrame path[VEB_MAX_DEPTH];
+    int depth = 0, r;
+    for (;;) {
+        if (!V || V->min == -1) {
+            r = 0;
+            break;
+        }
+        VEB_STAT_VISIT(V);
+        if (vEB_is_leaf(V)) {
+            r = leaf_member(V, x);
+            if (r) leaf_delete(V, x);
+            break;
+        }
+        if (V->min == V->max) {
+            r = (x == V->min);
+            if (r) V->min = V->max = -1;
+            break;
+        }
+        if (V->u == 2) {
+            // min != max, so both 0 and 1 are present
+            V->min = V->max = (x == 0) ? 1 : 0;
+            r = 1;
+            break;
+        }
+        if (x == V->min) {
+            int first = vEB_min(V->summary);
+            int off = vEB_min(vEB_cluster(V, first));
+            x = idx(V, first, off);
+            V->min = x;
+        }
+        int h = high(V, x), l = low(V, x);
+        vEBNode* C = vEB_cluster(V, h);
+        if (!C || C->min == -1) {
+            r = 0;
+            break;
+        }
+        if (C->min == C->max) {
+            VEB_STAT_VISIT(C);
+            if (l != C->min) {
+                r = 0;
+                break;
+            }
+            if (vEB_is_leaf(C)) leaf_delete(C, l);
+            else C->min = C->max = -1;
+        }
+        vEBFrame* f = &path[depth++];
+        f->V = V;
+        f->x = x;
+        if (C->min == -1) {
+            f->kind = VEB_IN_SUMMARY;
+            V = V->summary;
+            x = h;
+        }
+        else {
+            f->kind = VEB_IN_CLUSTER;
+            V = C;
+            x = l;
+        }
+    }
+    while (depth > 0) {
+        vEBFrame* f = &path[--depth];
+        V = f->V;
+        x = f->x;
+        int h = high(V, x);
+        if (f->kind == VEB_IN_SUMMARY) {
+            // cluster h lost its last key and the summary has dropped h
+            r = 1;
+            vEB_count_add(V, h, -1);
+            if (V->flags & VEB_FREE_EMPTY) vEB_release_cluster(V, h);
+            if (x == V->max) {
+                int smax = vEB_max(V->summary);
+                V->max = (smax == -1) ? V->min : idx(V, smax, vEB_max(vEB_cluster(V, smax)));
+            }
+        }
+        else if (r) {
+            vEB_count_add(V, h, -1);
+            if (x == V->max) V->max = idx(V, h, vEB_max(vEB_cluster(V, h)));
+        }
+    }
+    return r;
+}
+
+int vEB_delete(vEBNode* V, int x) {
+    if (!V) return 0;
+
+    if (x < 0 || x >= V->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, V->u);
+        return 0;
+    }
+    return vEB_delete_rec(V, x);
+}
+
+// Silent delete: 1 if x was removed, 0 if absent, VEB_ERANGE
+int vEB_try_delete(vEBNode* V, int x) {
+    if (!V) return 0;
+    if (x < 0 || x >= V->u) return VEB_ERANGE;
+    return vEB_delete_rec(V, x);
+}
+
+// PRIORITY QUEUE
+// extract_min/extract_max are the delete of the min/max without the
+// search: the key to remove is known at every level (it is the min/max of
+// the cluster it lives in, and that cluster is the summary's min/max), so
+// the descent never compares keys or splits them into high/low.
+static int vEB_extract_min_rec(vEBNode* V);
+static int vEB_extract_max_rec(vEBNode* V);
+
+// Cluster h of V has just lost its last key, and h is the summary's
+// min (or max, for extract_max)
+static void vEB_extracted_cluster(vEBNode* V, int h, int max) {
+    if (max) vEB_extract_max_rec(V->summary);
+    else vEB_extract_min_rec(V->summary);
+    if (V->flags & VEB_FREE_EMPTY) vEB_release_cluster(V, h);
+}
+
+static int vEB_extract_min_rec(vEBNode* V) {
+    VEB_STAT_VISIT(V);
+    int x = V->min;
+    if (vEB_is_leaf(V)) {
+        leaf_delete(V, x);
+        return x;
+    }
+    if (V->min == V->max) {
+        V->min = V->max = -1;
+        return x;
+    }
+    if (V->u == 2) {
+        V->min = 1;  // min != max, so the keys were 0 and 1
+        return x;
+    }
+    // promote the smallest clustered key and remove it from its cluster
+    int first = V->summary->min;
+    vEBNode* C = vEB_cluster(V, first);
+    V->min = idx(V, first, vEB_extract_min_rec(C));
+    vEB_count_add(V, first, -1);
+    // if C is now empty and held the max, the max is the new min: no update
+    if (C->min == -1) vEB_extracted_cluster(V, first, 0);
+    return x;
+}
+
+static int vEB_extract_max_rec(vEBNode* V) {
+    VEB_STAT_VISIT(V);
+    int x = V->max;
+    if (vEB_is_leaf(V)) {
+        leaf_delete(V, x);
+        return x;
+    }
+    if (V->min == V->max) {
+        V->min = V->max = -1;
+        return x;
+    }
+    if (V->u == 2) {
+        V->max = 0;
+        return x;
+    }
+    // the max is the max of the summary's last cluster
+    int last = V->summary->max;
+    vEBNode* C = vEB_cluster(V, last);
+    vEB_extract_max_rec(C);
+    vEB_count_add(V, last, -1);
+    if (C->min == -1) {
+        vEB_extracted_cluster(V, last, 1);
+        int smax = vEB_max(V->summary);
+        V->max = (smax == -1) ? V->min : idx(V, smax, vEB_cluster(V, smax)->max);
+    }
+    else {
+        V->max = idx(V, last, C->max);
+    }
+    return x;
+}
+
+// Remove and return the smallest key, or -1 if the tree is empty
+int vEB_extract_min(vEBNode* V) {
+    if (!V || V->min == -1) return -1;
+    return vEB_extract_min_rec(V);
+}
+
+// Remove and return the largest key, or -1 if the tree is empty
+int vEB_extract_max(vEBNode* V) {
+    if (!V || V->min == -1) return -1;
+    return vEB_extract_max_rec(V);
+}
+
+// Move present key x to y < x at node V. Where x is the min, y simply
+// replaces it; where x and y share a cluster, only that cluster and V's
+// max change, so the summary is not touched. Other cases are a delete and
+// an insert from this node down.
+static int vEB_decrease_rec(vEBNode* V, int x, int y) {
+    VEB_STAT_VISIT(V);
+    if (vEB_is_leaf(V)) {
+        int had_y = leaf_member(V, y);
+        leaf_delete(V, x);
+        if (!had_y) leaf_insert(V, y);
+        return 1;
+    }
+    if (x == V->min) {
+        V->min = y;
+        if (x == V->max) V->max = y;
+        return 1;
+    }
+    if (V->u > 2 && y > V->min && high(V, x) == high(V, y)) {
+        int h = high(V, x);
+        vEBNode* C = vEB_cluster(V, h);
+        int before = vEB_keys(C);
+        int r = vEB_decrease_rec(C, low(V, x), low(V, y));
+        vEB_count_add(V, h, vEB_keys(C) - before);  // -1 if y was present
+        if (x == V->max) V->max = idx(V, h, C->max);
+        return r;
+    }
+    vEB_delete_rec(V, x);
+    return vEB_insert_rec(V, y) < 0 ? VEB_ENOMEM : 1;
+}
+
+// DECREASE-KEY: replace key x by the smaller key y (timer rescheduled
+// earlier). Returns 1 if x was present and is now y; if y was already
+// present the two keys merge, since the tree is a set. Returns 0 (tree
+// unchanged) if x is absent or y is not in [0, x].
+// Exits on memory allocation failure, like vEB_insert.
+int vEB_decrease_key(vEBNode* V, int x, int y) {
+    if (x < 0 || x >= V->u || y < 0 || y > x) {
+        fprintf(stderr, "Error: decrease_key %d -> %d invalid (U = %d)\n", x, y, V->u);
+        return 0;
+    }
+    if (!vEB_member(V, x)) return 0;
+    if (x == y) return 1;
+    if (vEB_decrease_rec(V, x, y) == VEB_ENOMEM) {
+        perror("malloc vEB cluster");
+        exit(EXIT_FAILURE);
+    }
+    return 1;
+}
+
+// BATCH INSERT / DELETE
+// Sorted batches are applied as runs: at each node the keys are cut into
+// groups with the same high(x), and every group costs one cluster lookup,
+// at most one summary update and one recursive call, instead of a root
+// descent per key. A key is passed down unchanged, because its local value
+// at a node of universe u is simply key & (u - 1). Unsorted batches fall
+// back to one insert/delete per key.
+
+// VEB_OK if every key is in [0, u); *sorted tells whether keys are non-decreasing
+static int vEB_batch_check(vEBNode* V, const int* keys, int n, int* sorted) {
+    if (n < 0 || (n > 0 && !keys)) return VEB_EINVAL;
+    *sorted = 1;
+    for (int i = 0; i < n; i++) {
+        if (keys[i] < 0 || keys[i] >= V->u) return VEB_ERANGE;
+        if (i > 0 && keys[i] < keys[i - 1]) *sorted = 0;
+    }
+    return VEB_OK;
+}
+
+// Insert the sorted keys[0..n) (n > 0) into V; returns how many were new
+static int vEB_insert_run(vEBNode* V, const int* keys, int n) {
+    int umask = V->u - 1, added = 0;
+    if (vEB_is_leaf(V) || V->u <= 2) {
+        for (int i = 0; i < n; i++) {
+            int r = vEB_insert_rec(V, keys[i] & umask);
+            if (r < 0) return r;
+            added += r;
+        }
+        return added;
+    }
+
+    // the smallest key of the run may become the new min; the old min then
+    // moves into its cluster like in a single insert
+    int x0 = keys[0] & umask;
+    if (V->min == -1) {
+        V->min = V->max = x0;
+        added = 1;
+    }
+    else if (x0 < V->min) {
+        int old_min = V->min;
+        V->min = x0;
+        int r = vEB_insert_below(V, old_min);
+        if (r < 0) {
+            V->min = old_min;
+            return r;
+        }
+        added = 1;
+    }
+
+    // every key left is >= min, so duplicates of the min lead the run
+    for (int i = 0; i < n;) {
+        int x = keys[i] & umask;
+        if (x == V->min) {
+            i++;
+            continue;
+        }
+        int h = high(V, x), j = i + 1;
+        while (j < n && high(V, keys[j] & umask) == h) j++;
+
+        vEBNode* C = vEB_cluster_ensure(V, h);
+        if (!C) return VEB_ENOMEM;
+        if (C->min == -1) {
+            if (!V->summary) V->summary = vEB_alloc_child(V, V->upper_sqrt);
+            if (!V->summary || vEB_insert_rec(V->summary, h) < 0) return VEB_ENOMEM;
+        }
+        // an empty C takes its first key without allocating, so after the
+        // call C is non-empty and matches the summary even on VEB_ENOMEM
+        int before = vEB_keys(C);
+        int r = vEB_insert_run(C, keys + i, j - i);
+        vEB_count_add(V, h, vEB_keys(C) - before);
+        if (idx(V, h, C->max) > V->max) V->max = idx(V, h, C->max);
+        if (r < 0) return r;
+        added += r;
+        i = j;
+    }
+    return added;
+}
+
+// Delete the sorted keys[0..n) (n > 0) from V; returns how many were present
+static int vEB_delete_run(vEBNode* V, const int* keys, int n) {
+    if (!V || V->min == -1) return 0;
+    int umask = V->u - 1, removed = 0;
+    if (vEB_is_leaf(V) || V->u <= 2) {
+        for (int i = 0; i < n; i++) {
+            removed += vEB_delete_rec(V, keys[i] & umask);
+        }
+        return removed;
+    }
+
+    // keys up to the min are not in any cluster
+    int del_min = 0, i = 0;
+    for (; i < n && (keys[i] & umask) <= V->min; i++) {
+        if ((keys[i] & umask) == V->min) del_min = 1;
+    }
+
+    // clusters first; min and max are repaired once from what is left
+    while (i < n) {
+        int x = keys[i] & umask;
+        int h = high(V, x), j = i + 1;
+        while (j < n && high(V, keys[j] & umask) == h) j++;
+
+        vEBNode* C = vEB_cluster(V, h);
+        if (vEB_min(C) != -1) {
+            int r = vEB_delete_run(C, keys + i, j - i);
+            vEB_count_add(V, h, -r);
+            removed += r;
+            if (C->min == -1) vEB_cluster_emptied(V, h);
+        }
+        i = j;
+    }
+
+    if (del_min) {
+        removed++;
+        int first = vEB_min(V->summary);
+        if (first == -1) {
+            V->min = -1;
+        }
+        else {
+            // promote the smallest remaining key out of its cluster
+            vEBNode* C = vEB_cluster(V, first);
+            V->min = idx(V, first, C->min);
+            vEB_delete_rec(C, C->min);
+            vEB_count_add(V, first, -1);
+            if (C->min == -1) vEB_cluster_emptied(V, first);
+        }
+    }
+    int smax = vEB_max(V->summary);
+    V->max = (smax == -1) ? V->min : idx(V, smax, vEB_max(vEB_cluster(V, smax)));
+    return removed;
+}
+
+// Insert n keys; returns how many were new, VEB_ERANGE/VEB_EINVAL (nothing
+// inserted) or VEB_ENOMEM (the keys inserted so far stay in the tree)
+int vEB_insert_batch(vEBNode* V, const int* keys, int n) {
+    int sorted;
+    int err = vEB_batch_check(V, keys, n, &sorted);
+    if (err != VEB_OK) return err;
+    if (n == 0) return 0;
+    if (sorted) return vEB_insert_run(V, keys, n);
+
+    int added = 0;
+    for (int i = 0; i < n; i++) {
+        int r = vEB_insert_rec(V, keys[i]);
+        if (r < 0) return r;
+        added += r;
+    }
+    return added;
+}
+
+// Delete n keys; returns how many were present, or VEB_ERANGE/VEB_EINVAL
+// (nothing deleted)
+int vEB_delete_batch(vEBNode* V, const int* keys, int n) {
+    if (!V) return 0;
+    int sorted;
+    int err = vEB_batch_check(V, keys, n, &sorted);
+    if (err != VEB_OK) return err;
+    if (n == 0) return 0;
+    if (sorted) return vEB_delete_run(V, keys, n);
+
+    int removed = 0;
+    for (int i = 0; i < n; i++) {
+        removed += vEB_delete_rec(V, keys[i]);
+    }
+    return removed;
+}
+
+// COMPACTION
+// A lazy tree without VEB_FREE_EMPTY keeps every cluster and summary it
+// ever allocated, even after deletes have emptied them. vEB_compact
+// releases those in bounded steps that an idle loop can call: a post-order
+// sweep in cluster-index order at every node, with each node's summary
+// visited after its clusters, so an empty subtree has lost its children
+// by the time it is freed and no single free is large. Where the sweep
+// stopped is kept in a vEBSweep as one index per level, which stays
+// meaningful while the tree changes between calls.
+
+// Progress of vEB_compact; zero-initialize before the first call
+typedef struct vEBSweep {
+    int pos[VEB_MAX_DEPTH + 1];   // cluster index per level (upper_sqrt = summary)
+    uint64_t released;            // nodes freed by this sweep so far
+} vEBSweep;
+
+typedef struct vEBSweepRun {
+    vEBSweep* sweep;
+    long budget;                  // slots still to inspect in this call
+} vEBSweepRun;
+
+// Free the empty, already swept child of V at index s (s = upper_sqrt
+// is the summary); costs one slot plus its own cluster-array scan
+static void vEB_sweep_release(vEBSweepRun* R, vEBNode* V, int s, vEBNode* C) {
+    R->budget -= (vEB_is_leaf(C) || C->u <= 2) ? 1 : 1 + C->upper_sqrt;
+    vEB_free(C);
+    R->sweep->released++;
+    if (s == V->upper_sqrt) {
+        V->summary = NULL;
+    }
+    else if (V->flags & VEB_HASHED) {
+        size_t bytes = VEB_STAT_BYTES(V);
+        vEBHash_remove(&V->table, (uint64_t)s);
+        VEB_STAT_RESIZED(V, bytes);
+    }
+    else {
+        V->cluster[s] = NULL;
+    }
+}
+
+// Sweep V (at depth d) from sweep->pos[d]; 1 when V is done, 0 when the
+// budget ran out (the position is kept)
+static int vEB_sweep_node(vEBSweepRun* R, vEBNode* V, int d) {
+    if (vEB_is_leaf(V) || V->u <= 2) return 1;
+    int* pos = R->sweep->pos;
+    for (int s = pos[d]; s <= V->upper_sqrt; s++) {
+        if (--R->budget < 0) {
+            pos[d] = s;
+            return 0;
+        }
+        vEBNode* C = (s == V->upper_sqrt) ? V->summary : vEB_cluster(V, s);
+        if (C) {
+            if (!vEB_sweep_node(R, C, d + 1)) {
+                pos[d] = s;
+                return 0;
+            }
+            if (C->min == -1) vEB_sweep_release(R, V, s, C);
+        }
+        pos[d + 1] = 0;
+    }
+    pos[d] = 0;
+    return 1;
+}
+
+// Release up to about budget slots' worth of empty clusters and summaries
+// of lazy tree V, continuing where the previous call with the same sweep
+// stopped. Returns 1 when a full pass has finished (the sweep starts over
+// on the next call), 0 if the budget ran out first, or VEB_EINVAL.
+// Trees without VEB_LAZY allocate everything up front and return 1.
+int vEB_compact(vEBNode* V, vEBSweep* sweep, long budget) {
+    if (!V || !sweep || budget <= 0) return VEB_EINVAL;
+    if (!(V->flags & VEB_LAZY)) return 1;
+    vEBSweepRun R = {sweep, budget};
+    return vEB_sweep_node(&R, V, 0);
+}
+
+// FREE
+void vEB_free(vEBNode* V) {
+    if (!V) return;
+#ifdef VEB_STATS
+    if (V->stats && V->stats->root == V) {
+        // the counters outlive the nodes that still update them
+        vEBStatsBlock* S = V->stats;
+        S->root = NULL;
+        vEB_free(V);
+        free(S);
+        return;
+    }
+#endif
+    VEB_STAT_ADD(V, nodes_freed, 1);
+    VEB_STAT_ADD(V, bytes_resident, 0 - VEB_STAT_BYTES(V));
+    if (V->flags & VEB_ARENA) {
+        // V is the root and the start of the block; arena trees are eager,
+        // so nothing inside was heap-allocated on its own
+        free(V);
+        return;
+    }
+    if (vEB_is_leaf(V)) {
+        free(V);
+        return;
+    }
+
+    if (V->flags & VEB_HASHED) {
+        if (V->table) {
+            vEBHashSlot* s = vEBHash_slots(V->table);
+            for (uint32_t i = 0; i < V->table->cap; i++) {
+                if (s[i].val) vEB_free((vEBNode*)s[i].val);
+            }
+            free(V->table);
+        }
+    }
+    else if (V->cluster) {
+        for (int i = 0; i < V->upper_sqrt; i++) {
+            vEB_free(V->cluster[i]);
+        }
+        free(V->cluster);
+    }
+
+    vEB_free(V->summary);
+    free(V);
+}
+
+// Copy the counters of tree V into *out. Returns VEB_OK, or VEB_EINVAL
+// with *out zeroed if V is not a root or the build lacks VEB_STATS
+int vEB_stats(vEBNode* V, vEBStats* out) {
+    memset(out, 0, sizeof(*out));
+#ifdef VEB_STATS
+    if (V && V->stats && V->stats->root == V) {
+        *out = V->stats->s;
+        return VEB_OK;
+    }
+#endif
+    (void)V;
+    return VEB_EINVAL;
+}
+
+// Zero the operation counters of tree V (allocation counters are kept)
+void vEB_stats_reset(vEBNode* V) {
+#ifdef VEB_STATS
+    if (!V || !V->stats || V->stats->root != V) return;
+    vEBStats* s = &V->stats->s;
+    s->ops = s->levels = s->max_depth = s->summary_falls = s->minmax_hits = 0;
+#endif
+    (void)V;
+}
+
+// BULK BUILD
+// vEB_build_sorted creates a lazy tree straight from sorted keys: every
+// node takes the first key as its min, hands each run of keys with the
+// same high(x) to a freshly built cluster, and builds its summary from the
+// list of those highs. Each level is a single pass over the keys and only
+// non-empty clusters are allocated.
+
+// Scratch ints needed to build a tree of universe U: each node collects
+// up to upper_sqrt highs, which stay live while its clusters and summary
+// (both no larger than upper_sqrt) are built on top of them
+static size_t vEB_build_scratch(int U, unsigned flags) {
+    if (((flags & VEB_BITMAP_LEAVES) && U <= VEB_LEAF_BITS) || U <= 2) return 0;
+    int lg = log2_int(U);
+    int upper = 1 << (lg - lg / 2);
+    return (size_t)upper + vEB_build_scratch(upper, flags);
+}
+
+// Build the subtree of universe U over the sorted keys[0..n) (n > 0, local
+// key = key & (U - 1)); NULL on allocation failure
+static vEBNode* vEB_build_run(int U, unsigned flags, const int* keys, int n, int* scratch) {
+    vEBNode* V = vEB_alloc_tree(U, flags);
+    if (!V) return NULL;
+    int umask = U - 1;
+    if (vEB_is_leaf(V) || U <= 2) {
+        for (int i = 0; i < n; i++) {
+            vEB_insert_rec(V, keys[i] & umask); // never allocates at this size
+        }
+        return V;
+    }
+
+    V->min = keys[0] & umask;
+    V->max = keys[n - 1] & umask;
+    int i = 1;
+    while (i < n && (keys[i] & umask) == V->min) i++;
+    if (i == n) return V;
+
+    int* highs = scratch;
+    int groups = 0, ok = 1;
+    while (ok && i < n) {
+        int h = high(V, keys[i] & umask), j = i + 1;
+        while (j < n && high(V, keys[j] & umask) == h) j++;
+        vEBNode* C = vEB_build_run(V->lower_sqrt, flags, keys + i, j - i, scratch + V->upper_sqrt);
+        if (!C) {
+            ok = 0;
+        }
+        else if (flags & VEB_HASHED) {
+            ok = vEBHash_put(&V->table, (uint64_t)h, C);
+            if (!ok) vEB_free(C);
+        }
+        else {
+            V->cluster[h] = C;
+            vEB_count_add(V, h, vEB_keys(C));
+        }
+        highs[groups++] = h;
+        i = j;
+    }
+    if (ok) {
+        V->summary = vEB_build_run(V->upper_sqrt, flags, highs, groups, scratch + V->upper_sqrt);
+        ok = V->summary != NULL;
+    }
+    if (!ok) {
+        vEB_free(V); // frees whatever clusters were attached so far
+        return NULL;
+    }
+    return V;
+}
+
+// Build a tree holding keys[0..n), which must be sorted (duplicates are
+// allowed) and lie in [0, U). flags must include VEB_LAZY and not
+// VEB_ARENA. Returns NULL with VEB_EINVAL, VEB_ERANGE or VEB_ENOMEM in
+// *err (if err is not NULL) on failure.
+vEBNode* vEB_build_sorted_ex(int U, unsigned flags, const int* keys, int n, int* err) {
+    int status = VEB_OK;
+    vEBNode* V = NULL;
+    if (vEB_check_args(U, flags) || !(flags & VEB_LAZY) || n < 0 || (n > 0 && !keys)) {
+        status = VEB_EINVAL;
+    }
+    else {
+        for (int i = 0; i < n && status == VEB_OK; i++) {
+            if (keys[i] < 0 || keys[i] >= U) status = VEB_ERANGE;
+            else if (i > 0 && keys[i] < keys[i - 1]) status = VEB_EINVAL;
+        }
+    }
+    if (status == VEB_OK && n == 0) {
+        V = vEB_stats_attach(vEB_alloc_tree(U, flags));
+        if (!V) status = VEB_ENOMEM;
+    }
+    else if (status == VEB_OK) {
+        // + 1 keeps the request non-zero for trees that are a single leaf
+        int* scratch = (int*)malloc((vEB_build_scratch(U, flags) + 1) * sizeof(int));
+        if (scratch) V = vEB_stats_attach(vEB_build_run(U, flags, keys, n, scratch));
+        if (!V) status = VEB_ENOMEM;
+        free(scratch);
+    }
+    if (err) *err = status;
+    return V;
+}
+
+// Lazy tree from sorted keys; NULL on invalid input or allocation failure
+vEBNode* vEB_build_sorted(int U, const int* keys, int n) {
+    return vEB_build_sorted_ex(U, VEB_LAZY, keys, n, NULL);
+}
+
+// SET ALGEBRA
+// vEB_union/vEB_intersect/vEB_difference walk both trees together: the
+// clusters to visit come from the two summaries (merged for union,
+// leapfrogged for intersection, taken from A for difference), so a cluster
+// that is empty on the deciding side is never entered, and a cluster that
+// only one side has is either skipped or copied with a range walk. Bitmap
+// leaves are combined a word at a time.
+// The result keys come out in increasing order and are added to the new
+// tree in sorted runs with vEB_insert_batch. Each node's min lives outside
+// its clusters, so the two mins are decided with a member probe on the
+// other tree and held back until the walk passes them. For difference,
+// B's min is noted so it is dropped if A's clusters produce it.
+#define VEB_SETOP_UNION 0
+#define VEB_SETOP_INTERSECT 1
+#define VEB_SETOP_DIFFERENCE 2
+#define VEB_SETOP_RUN 1024
+#define VEB_SETOP_HELD (2 * VEB_MAX_DEPTH + 4)
+
+typedef struct vEBSetOp {
+    int op;
+    vEBNode* out;
+    int status;
+    int last;                  // last key handed to out, -1 before the first
+    int run[VEB_SETOP_RUN];
+    int n;
+    int held[VEB_SETOP_HELD];  // result keys waiting for the walk to pass them, sorted
+    int nheld;
+    int drop[VEB_SETOP_HELD];  // keys to leave out (difference), sorted
+    int ndrop;
+} vEBSetOp;
+
+static void vEB_setop_flush(vEBSetOp* S) {
+    if (S->n > 0 && S->status == VEB_OK) {
+        int r = vEB_insert_batch(S->out, S->run, S->n);
+        if (r < 0) S->status = r;
+    }
+    S->n = 0;
+}
+
+static void vEB_setop_put(vEBSetOp* S, int key) {
+    if (key == S->last) return;   // both trees produced it
+    S->last = key;
+    S->run[S->n++] = key;
+    if (S->n == VEB_SETOP_RUN) vEB_setop_flush(S);
+}
+
+static void vEB_setop_sorted_add(int* a, int* n, int key) {
+    int i = (*n)++;
+    for (; i > 0 && a[i - 1] > key; i--) a[i] = a[i - 1];
+    a[i] = key;
+}
+
+static void vEB_setop_shift(int* a, int* n) {
+    memmove(a, a + 1, (size_t)(--*n) * sizeof(int));
+}
+
+// Pass key on unless it is to be dropped; drop entries below key are done
+static void vEB_setop_filter(vEBSetOp* S, int key) {
+    while (S->ndrop > 0 && S->drop[0] < key) vEB_setop_shift(S->drop, &S->ndrop);
+    if (S->ndrop > 0 && S->drop[0] == key) return;
+    vEB_setop_put(S, key);
+}
+
+// Hand over the held keys <= key
+static void vEB_setop_release(vEBSetOp* S, int key) {
+    while (S->nheld > 0 && S->held[0] <= key) {
+        vEB_setop_filter(S, S->held[0]);
+        vEB_setop_shift(S->held, &S->nheld);
+    }
+}
+
+// The walk is past limit: nothing held or dropped up to it matters any more
+static void vEB_setop_passed(vEBSetOp* S, int limit) {
+    vEB_setop_release(S, limit);
+    while (S->ndrop > 0 && S->drop[0] <= limit) vEB_setop_shift(S->drop, &S->ndrop);
+}
+
+static void vEB_setop_emit(vEBSetOp* S, int key) {
+    vEB_setop_release(S, key);
+    vEB_setop_filter(S, key);
+}
+
+static int vEB_setop_visit(int key, void* ctx) {
+    vEB_setop_emit((vEBSetOp*)ctx, key);
+    return 0;
+}
+
+// All keys of V, offset by base
+static void vEB_setop_copy(vEBSetOp* S, vEBNode* V, int base) {
+    if (vEB_min(V) == -1) return;
+    vEBRangeWalk W = { vEB_setop_visit, S, 0, 0 };
+    vEB_range_walk(V, 0, V->u - 1, base, &W);
+}
+
+static int vEB_setop_keep(int op, int in_a, int in_b) {
+    if (op == VEB_SETOP_UNION) return in_a || in_b;
+    if (op == VEB_SETOP_INTERSECT) return in_a && in_b;
+    return in_a && !in_b;
+}
+
+// Key by key, for nodes the structural walk cannot pair up (u <= 2, or a
+// bitmap leaf facing an internal node because the flags differ)
+static void vEB_setop_keys(vEBSetOp* S, vEBNode* A, vEBNode* B, int base) {
+    int union_op = S->op == VEB_SETOP_UNION;
+    int x = vEB_min(A), y = union_op ? vEB_min(B) : -1;
+    while (x != -1 || y != -1) {
+        int k = (y == -1 || (x != -1 && x < y)) ? x : y;
+        if (vEB_setop_keep(S->op, vEB_member(A, k), vEB_member(B, k))) vEB_setop_emit(S, base + k);
+        if (x == k) x = vEB_successor(A, k);
+        if (y == k) y = vEB_successor(B, k);
+    }
+}
+
+static void vEB_setop_walk(vEBSetOp* S, vEBNode* A, vEBNode* B, int base) {
+    int op = S->op;
+    int a_empty = vEB_min(A) == -1, b_empty = vEB_min(B) == -1;
+    if (a_empty && (b_empty || op != VEB_SETOP_UNION)) return;
+    if (b_empty || a_empty) {
+        if (op != VEB_SETOP_INTERSECT) vEB_setop_copy(S, a_empty ? B : A, base);
+        return;
+    }
+    if (vEB_is_leaf(A) && vEB_is_leaf(B)) {
+        for (int w = 0; w < VEB_LEAF_WORDS; w++) {
+            uint64_t word = (op == VEB_SETOP_UNION) ? (A->bits[w] | B->bits[w])
+                : (op == VEB_SETOP_INTERSECT) ? (A->bits[w] & B->bits[w])
+                : (A->bits[w] & ~B->bits[w]);
+            for (; word; word &= word - 1) {
+                vEB_setop_emit(S, base + (w << 6) + __builtin_ctzll(word));
+            }
+        }
+        return;
+    }
+    if (vEB_is_leaf(A) || vEB_is_leaf(B) || A->u <= 2) {
+        vEB_setop_keys(S, A, B, base);
+        return;
+    }
+
+    // the mins are not in the clusters: decide them here, emit them in order
+    if (vEB_setop_keep(op, 1, vEB_member(B, A->min))) vEB_setop_sorted_add(S->held, &S->nheld, base + A->min);
+    if (op == VEB_SETOP_DIFFERENCE) vEB_setop_sorted_add(S->drop, &S->ndrop, base + B->min);
+    else if (vEB_setop_keep(op, vEB_member(A, B->min), 1)) vEB_setop_sorted_add(S->held, &S->nheld, base + B->min);
+
+    int ha = vEB_min(A->summary), hb = vEB_min(B->summary);
+    while (ha != -1 && (hb != -1 || op != VEB_SETOP_INTERSECT) && S->status == VEB_OK) {
+        if (op == VEB_SETOP_INTERSECT && ha != hb) {
+            // leapfrog to the next cluster both sides have
+            if (ha < hb) ha = vEB_successor(A->summary, hb - 1);
+            else hb = vEB_successor(B->summary, ha - 1);
+            continue;
+        }
+        if (op == VEB_SETOP_DIFFERENCE) {
+            while (hb != -1 && hb < ha) hb = vEB_successor(B->summary, ha - 1);
+        }
+        int h = (hb == -1 || ha < hb) ? ha : hb;
+        vEB_setop_walk(S, (h == ha) ? vEB_cluster(A, h) : NULL,
+                       (h == hb) ? vEB_cluster(B, h) : NULL, base + (h << A->shift));
+        if (h == ha) ha = vEB_successor(A->summary, h);
+        if (h == hb) hb = vEB_successor(B->summary, h);
+    }
+    if (op == VEB_SETOP_UNION) {
+        for (; hb != -1 && S->status == VEB_OK; hb = vEB_successor(B->summary, hb)) {
+            vEB_setop_copy(S, vEB_cluster(B, hb), base + (hb << A->shift));
+        }
+    }
+    vEB_setop_passed(S, base + A->u - 1);
+}
+
+static vEBNode* vEB_set_op(vEBNode* A, vEBNode* B, int op) {
+    if (!A || !B || A->u != B->u) {
+        fprintf(stderr, "Error: set operations need two trees of the same size\n");
+        return NULL;
+    }
+    int err;
+    vEBNode* out = vEB_try_create(A->u, A->flags & VEB_CREATE_FLAGS, &err);
+    if (!out) return NULL;
+    vEBSetOp* S = (vEBSetOp*)malloc(sizeof(vEBSetOp));
+    if (!S) {
+        vEB_free(out);
+        return NULL;
+    }
+    S->op = op;
+    S->out = out;
+    S->status = VEB_OK;
+    S->last = -1;
+    S->n = S->nheld = S->ndrop = 0;
+    vEB_setop_walk(S, A, B, 0);
+    vEB_setop_passed(S, A->u - 1);
+    vEB_setop_flush(S);
+    if (S->status != VEB_OK) {
+        vEB_free(out);
+        out = NULL;
+    }
+    free(S);
+    return out;
+}
+
+// New trees (with A's flags) holding A | B, A & B and A \ B. A and B must
+// have the same universe size. NULL on mismatched sizes or allocation failure
+vEBNode* vEB_union(vEBNode* A, vEBNode* B) { return vEB_set_op(A, B, VEB_SETOP_UNION); }
+vEBNode* vEB_intersect(vEBNode* A, vEBNode* B) { return vEB_set_op(A, B, VEB_SETOP_INTERSECT); }
+vEBNode* vEB_difference(vEBNode* A, vEBNode* B) { return vEB_set_op(A, B, VEB_SETOP_DIFFERENCE); }
+
+// CONCURRENT READERS
+// vEBConcurrent lets any number of threads query while writers update,
+// without readers ever taking a lock. It is the left-right scheme: two
+// copies of the tree, readers use the one left_right points to, and a
+// writer (serialized by a mutex) applies each change with vEB_insert /
+// vEB_delete to the copy nobody reads, flips left_right, waits until the
+// readers still on the old copy have left, and replays the change there.
+// Readers announce themselves on one of two striped counter sets (picked
+// by version), so they do not contend on a single cache line, and the
+// writer drains one set at a time. Memory is twice that of one tree and a
+// write costs two updates plus the wait; reads are a few atomic adds on
+// top of the plain query.
+#define VEB_READ_STRIPES 64
+
+typedef struct vEBReadStripe {
+    long readers;
+    char pad[64 - sizeof(long)]; // one counter per cache line
+} vEBReadStripe;
+
+typedef struct vEBConcurrent {
+    vEBNode* side[2];
+    int left_right;          // copy that new readers use
+    int version;             // counter set that new readers arrive on
+    pthread_mutex_t writer;
+    vEBReadStripe indicator[2][VEB_READ_STRIPES];
+} vEBConcurrent;
+
+// Exits on invalid U/flags or memory allocation failure, like vEB_create_ex
+vEBConcurrent* vEBConcurrent_create(int U, unsigned flags) {
+    vEBConcurrent* T = (vEBConcurrent*)calloc(1, sizeof(vEBConcurrent));
+    if (!T) {
+        perror("calloc vEBConcurrent");
+        exit(EXIT_FAILURE);
+    }
+    T->side[0] = vEB_create_ex(U, flags);
+    T->side[1] = vEB_create_ex(U, flags);
+    pthread_mutex_init(&T->writer, NULL);
+    return T;
+}
+
+// No reader or writer may still be using T
+void vEBConcurrent_free(vEBConcurrent* T) {
+    if (!T) return;
+    vEB_free(T->side[0]);
+    vEB_free(T->side[1]);
+    pthread_mutex_destroy(&T->writer);
+    free(T);
+}
+
+// Each thread keeps using the stripe it was handed first
+static unsigned vEB_read_stripe(void) {
+    static unsigned next_stripe;
+    static __thread unsigned stripe = 0;   // 0 = not assigned yet
+    if (!stripe) stripe = __atomic_add_fetch(&next_stripe, 1, __ATOMIC_RELAXED) % VEB_READ_STRIPES + 1;
+    return stripe - 1;
+}
+
+static vEBNode* vEB_read_enter(vEBConcurrent* T, long** counter) {
+    int v = __atomic_load_n(&T->version, __ATOMIC_SEQ_CST);
+    *counter = &T->indicator[v][vEB_read_stripe()].readers;
+    __atomic_fetch_add(*counter, 1, __ATOMIC_SEQ_CST);
+    return T->side[__atomic_load_n(&T->left_right, __ATOMIC_SEQ_CST)];
+}
+
+static void vEB_read_leave(long* counter) {
+    __atomic_fetch_sub(counter, 1, __ATOMIC_RELEASE);
+}
+
+static void vEB_wait_readers(vEBConcurrent* T, int v) {
+    for (int i = 0; i < VEB_READ_STRIPES; i++) {
+        while (__atomic_load_n(&T->indicator[v][i].readers, __ATOMIC_ACQUIRE) != 0) sched_yield();
+    }
+}
+
+// Apply op(x) to both copies; returns op's result
+static int vEBConcurrent_write(vEBConcurrent* T, int (*op)(vEBNode*, int), int x) {
+    pthread_mutex_lock(&T->writer);
+    int lr = T->left_right;
+    int r = op(T->side[!lr], x);
+    if (r > 0) {
+        __atomic_store_n(&T->left_right, !lr, __ATOMIC_SEQ_CST);
+        // readers may still be on side[lr]: drain both counter sets, the
+        // idle one first so that late arrivals move over to it
+        int v = T->version;
+        vEB_wait_readers(T, !v);
+        __atomic_store_n(&T->version, !v, __ATOMIC_SEQ_CST);
+        vEB_wait_readers(T, v);
+        op(T->side[lr], x);
+    }
+    pthread_mutex_unlock(&T->writer);
+    return r;
+}
+
+// Writers: same results as vEB_insert / vEB_delete (a no-op skips the swap)
+int vEBConcurrent_insert(vEBConcurrent* T, int x) { return vEBConcurrent_write(T, vEB_insert, x); }
+int vEBConcurrent_delete(vEBConcurrent* T, int x) { return vEBConcurrent_write(T, vEB_delete, x); }
+
+// Readers: lock-free, may run in any number of threads
+int vEBConcurrent_member(vEBConcurrent* T, int x) {
+    long* counter;
+    int r = vEB_member(vEB_read_enter(T, &counter), x);
+    vEB_read_leave(counter);
+    return r;
+}
+
+int vEBConcurrent_successor(vEBConcurrent* T, int x) {
+    long* counter;
+    int r = vEB_successor(vEB_read_enter(T, &counter), x);
+    vEB_read_leave(counter);
+    return r;
+}
+
+int vEBConcurrent_predecessor(vEBConcurrent* T, int x) {
+    long* counter;
+    int r = vEB_predecessor(vEB_read_enter(T, &counter), x);
+    vEB_read_leave(counter);
+    return r;
+}
+
+// NUMA REPLICAS
+// vEBReplicated keeps one vEBConcurrent copy of the tree per NUMA node, so
+// a reader's every level is a node-local access. Each replica is created
+// by a thread pinned to the CPUs of its node: the node structs, cluster
+// arrays and VEB_ARENA blocks are written there first, and the kernel's
+// first-touch policy places their pages on that node. Writers go through
+// one mutex and replay every insert/delete on all replicas in the same
+// order, so the replicas never diverge; readers use the replica of the
+// node they are running on, found with sched_getcpu(), and stay lock-free.
+// Lazy trees allocate on the writer's thread after creation, so only
+// their nodes allocated at create time are node-local; an eager or
+// VEB_ARENA tree is placed completely. Topology comes from
+// /sys/devices/system/node; without it (or off Linux) there is one node.
+#define VEB_MAX_NUMA_NODES 64
+#define VEB_MAX_CPUS 1024
+
+// sched_getcpu and CPU_SET are only declared if _GNU_SOURCE was defined
+// before the first system header; a program that includes this file after
+// its own headers gets the single-node fallback
+#if defined(__linux__) && defined(CPU_SETSIZE)
+#define VEB_HAVE_AFFINITY 1
+#endif
+
+static int vEB_numa_count = 1;
+static short vEB_cpu_node[VEB_MAX_CPUS];   // dense node index of each CPU
+static pthread_once_t vEB_numa_once = PTHREAD_ONCE_INIT;
+
+// Next range a-b of a sysfs list such as "0-3,8,10-11"; 0 at the end
+static int vEB_list_next(const char** s, int* a, int* b) {
+    char* end;
+    while (**s == ',') (*s)++;
+    long lo = strtol(*s, &end, 10);
+    if (end == *s) return 0;
+    long hi = lo;
+    if (*end == '-') {
+        const char* p = end + 1;
+        hi = strtol(p, &end, 10);
+        if (end == p) return 0;
+    }
+    *s = end;
+    *a = (int)lo;
+    *b = (int)hi;
+    return 1;
+}
+
+// Read a small sysfs file into buf; 0 if it does not exist
+static int vEB_read_sysfs(const char* path, char* buf, size_t size) {
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    size_t n = fread(buf, 1, size - 1, f);
+    fclose(f);
+    buf[n] = '\0';
+    return 1;
+}
+
+static void vEB_numa_scan(void) {
+#ifdef VEB_HAVE_AFFINITY
+    char buf[4096], path[64];
+    if (!vEB_read_sysfs("/sys/devices/system/node/online", buf, sizeof buf)) return;
+    int ids[VEB_MAX_NUMA_NODES], n = 0, a, b;
+    const char* s = buf;
+    while (n < VEB_MAX_NUMA_NODES && vEB_list_next(&s, &a, &b)) {
+        for (int id = a; id <= b && n < VEB_MAX_NUMA_NODES; id++) ids[n++] = id;
+    }
+    if (n < 2) return;
+    for (int i = 0; i < n; i++) {
+        snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", ids[i]);
+        if (!vEB_read_sysfs(path, buf, sizeof buf)) continue;
+        s = buf;
+        while (vEB_list_next(&s, &a, &b)) {
+            for (int cpu = a; cpu <= b && cpu < VEB_MAX_CPUS; cpu++) {
+                if (cpu >= 0) vEB_cpu_node[cpu] = (short)i;
+            }
+        }
+    }
+    vEB_numa_count = n;
+#endif
+}
+
+// Number of NUMA nodes (1 on machines without NUMA)
+int vEB_numa_nodes(void) {
+    pthread_once(&vEB_numa_once, vEB_numa_scan);
+    return vEB_numa_count;
+}
+
+// NUMA node (0 .. vEB_numa_nodes() - 1) of the CPU the caller runs on
+int vEB_numa_node(void) {
+    if (vEB_numa_nodes() == 1) return 0;
+#ifdef VEB_HAVE_AFFINITY
+    int cpu = sched_getcpu();
+    if (cpu >= 0 && cpu < VEB_MAX_CPUS) return vEB_cpu_node[cpu];
+#endif
+    return 0;
+}
+
+typedef struct vEBReplicated {
+    int replicas;
+    int node[VEB_MAX_NUMA_NODES];       // NUMA node replica i was built on
+    int by_node[VEB_MAX_NUMA_NODES];    // replica that readers on node n use
+    pthread_mutex_t writer;
+    vEBConcurrent* rep[VEB_MAX_NUMA_NODES];
+} vEBReplicated;
+
+typedef struct vEBReplicaJob {
+    int U;
+    unsigned flags;
+    int node;
+    vEBConcurrent* out;
+} vEBReplicaJob;
+
+// Pin the calling thread to the CPUs of node (best effort)
+static void vEB_pin_to_node(int node) {
+#ifdef VEB_HAVE_AFFINITY
+    if (vEB_numa_nodes() == 1) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < VEB_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (vEB_cpu_node[cpu] == node) CPU_SET(cpu, &set);
+    }
+    sched_setaffinity(0, sizeof(set), &set); // a restricted cpuset just leaves placement to the kernel
+#else
+    (void)node;
+#endif
+}
+
+static void* vEB_build_replica(void* arg) {
+    vEBReplicaJob* J = (vEBReplicaJob*)arg;
+    vEB_pin_to_node(J->node);
+    J->out = vEBConcurrent_create(J->U, J->flags);
+    return NULL;
+}
+
+// Create replicas copies of an empty tree of size U, spread over the NUMA
+// nodes round-robin; replicas <= 0 means one per node. flags are passed
+// to vEB_create_ex for every copy.
+// Exits on invalid arguments or memory allocation failure
+vEBReplicated* vEBReplicated_create(int U, unsigned flags, int replicas) {
+    int nodes = vEB_numa_nodes();
+    if (replicas <= 0) replicas = nodes;
+    if (replicas > VEB_MAX_NUMA_NODES) {
+        fprintf(stderr, "Error: replicas=%d exceeds %d\n", replicas, VEB_MAX_NUMA_NODES);
+        exit(EXIT_FAILURE);
+    }
+    const char* why = vEB_check_args(U, flags);
+    if (why) {
+        fprintf(stderr, "Error: U=%d, flags=0x%x: %s\n", U, flags, why);
+        exit(EXIT_FAILURE);
+    }
+    vEBReplicated* R = (vEBReplicated*)calloc(1, sizeof(vEBReplicated));
+    if (!R) {
+        perror("calloc vEBReplicated");
+        exit(EXIT_FAILURE);
+    }
+    R->replicas = replicas;
+    for (int i = 0; i < replicas; i++) {
+        vEBReplicaJob J;
+        J.U = U;
+        J.flags = flags;
+        J.node = i % nodes;
+        J.out = NULL;
+        pthread_t tid;
+        // a fresh thread, so the caller's own affinity is left alone
+        if (pthread_create(&tid, NULL, vEB_build_replica, &J) == 0) pthread_join(tid, NULL);
+        else J.out = vEBConcurrent_create(U, flags);
+        R->rep[i] = J.out;
+        R->node[i] = J.node;
+    }
+    for (int n = 0; n < nodes; n++) R->by_node[n] = n % replicas;
+    pthread_mutex_init(&R->writer, NULL);
+    return R;
+}
+
+// No reader or writer may still be using R
+void vEBReplicated_free(vEBReplicated* R) {
+    if (!R) return;
+    for (int i = 0; i < R->replicas; i++) vEBConcurrent_free(R->rep[i]);
+    pthread_mutex_destroy(&R->writer);
+    free(R);
+}
+
+// Replica that a reader on the calling thread's node uses
+vEBConcurrent* vEBReplicated_local(vEBReplicated* R) {
+    return R->rep[R->by_node[vEB_numa_node()]];
+}
+
+// Apply op(x) to every replica in turn; returns op's result on replica 0
+static int vEBReplicated_write(vEBReplicated* R, int (*op)(vEBConcurrent*, int), int x) {
+    pthread_mutex_lock(&R->writer);
+    int r = op(R->rep[0], x);
+    if (r > 0) {
+        for (int i = 1; i < R->replicas; i++) op(R->rep[i], x);
+    }
+    pthread_mutex_unlock(&R->writer);
+    return r;
+}
+
+// Writers: same results as vEB_insert / vEB_delete
+int vEBReplicated_insert(vEBReplicated* R, int x) { return vEBReplicated_write(R, vEBConcurrent_insert, x); }
+int vEBReplicated_delete(vEBReplicated* R, int x) { return vEBReplicated_write(R, vEBConcurrent_delete, x); }
+
+// Readers: lock-free, served by the replica on the caller's node
+int vEBReplicated_member(vEBReplicated* R, int x) { return vEBConcurrent_member(vEBReplicated_local(R), x); }
+int vEBReplicated_successor(vEBReplicated* R, int x) { return vEBConcurrent_successor(vEBReplicated_local(R), x); }
+int vEBReplicated_predecessor(vEBReplicated* R, int x) { return vEBConcurrent_predecessor(vEBReplicated_local(R), x); }
+
+// ATOMIC BITMAP TREE
+// vEBAtomic is a concurrent set for U <= 2^26 that any number of threads
+// may insert into, delete from and query at the same time, without locks
+// on the update path. It is the bitmap form of the vEB recursion with a
+// fan-out of 64: level 0 holds one bit per key, and bit i of level l is a
+// summary bit saying word i of level l-1 may be non-empty.
+//   - insert sets its key bit with fetch_or, then makes sure every summary
+//     bit above it is set (a load, and a fetch_or only if it is clear), so
+//     once insert returns the key is reachable from the top.
+//   - delete clears its key bit with fetch_and. If that emptied the word,
+//     the summary bit is repaired lazily: under the summary word's version
+//     (a seqlock taken with a CAS, skipped if another repair holds it) the
+//     bit is cleared, the child is re-checked and the bit put back if an
+//     insert refilled it meanwhile; emptied summary words repeat this one
+//     level up. A skipped repair only leaves a stale set bit behind.
+//   - queries walk the levels like vEB_successor, but a summary bit may be
+//     stale, so an empty child just sends the search on to the next bit.
+//     Summary words are read under their version and re-read while a
+//     repair is in progress, so a repair's clear-then-restore window can
+//     not hide a key.
+#define VEBA_MAX_LG 26
+#define VEBA_MAX_LEVELS 5      // ceil(VEBA_MAX_LG / 6)
+
+typedef struct vEBAtomic {
+    int u;
+    int levels;                          // bitmap levels; levels - 1 is a single word
+    size_t words[VEBA_MAX_LEVELS];       // words per level
+    uint64_t* bits[VEBA_MAX_LEVELS];
+    uint32_t* version[VEBA_MAX_LEVELS];  // levels >= 1: odd while a repair runs
+} vEBAtomic;
+
+// Create an empty tree of size U (power of two, 2 <= U <= 2^26)
+// Exits on invalid U or memory allocation failure
+vEBAtomic* vEBAtomic_create(int U) {
+    if (U < 2 || (U & (U - 1)) != 0 || U > (1 << VEBA_MAX_LG)) {
+        fprintf(stderr, "Error: U=%d must be a power of two in [2, 2^%d]\n", U, VEBA_MAX_LG);
+        exit(EXIT_FAILURE);
+    }
+    vEBAtomic* A = (vEBAtomic*)calloc(1, sizeof(vEBAtomic));
+    if (!A) {
+        perror("calloc vEBAtomic");
+        exit(EXIT_FAILURE);
+    }
+    A->u = U;
+    size_t n = (size_t)U;
+    do {
+        int l = A->levels++;
+        A->words[l] = (n + 63) / 64;
+        A->bits[l] = (uint64_t*)calloc(A->words[l], sizeof(uint64_t));
+        A->version[l] = (uint32_t*)calloc(A->words[l], sizeof(uint32_t));
+        if (!A->bits[l] || !A->version[l]) {
+            perror("calloc vEBAtomic level");
+            exit(EXIT_FAILURE);
+        }
+        n = A->words[l];
+    } while (n > 1);
+    return A;
+}
+
+// No other thread may still be using A
+void vEBAtomic_free(vEBAtomic* A) {
+    if (!A) return;
+    for (int l = 0; l < A->levels; l++) {
+        free(A->bits[l]);
+        free(A->version[l]);
+    }
+    free(A);
+}
+
+// Word w of level l, consistent with respect to summary repairs
+static uint64_t vEBA_read(const vEBAtomic* A, int l, size_t w) {
+    if (l == 0) return __atomic_load_n(&A->bits[0][w], __ATOMIC_SEQ_CST);
+    for (;;) {
+        uint32_t v = __atomic_load_n(&A->version[l][w], __ATOMIC_SEQ_CST);
+        if (v & 1) {
+            sched_yield();
+            continue;
+        }
+        uint64_t word = __atomic_load_n(&A->bits[l][w], __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&A->version[l][w], __ATOMIC_SEQ_CST) == v) return word;
+    }
+}
+
+int vEBAtomic_member(const vEBAtomic* A, int x) {
+    if (x < 0 || x >= A->u) return 0;
+    return (int)((__atomic_load_n(&A->bits[0][x >> 6], __ATOMIC_SEQ_CST) >> (x & 63)) & 1);
+}
+
+// INSERT: returns 1 if x was added, 0 if it was already present
+int vEBAtomic_insert(vEBAtomic* A, int x) {
+    if (x < 0 || x >= A->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, A->u);
+        return 0;
+    }
+    uint64_t bit = 1ULL << (x & 63);
+    uint64_t old = __atomic_fetch_or(&A->bits[0][x >> 6], bit, __ATOMIC_SEQ_CST);
+    size_t i = (size_t)x >> 6;   // word index at the level below
+    for (int l = 1; l < A->levels; i >>= 6, l++) {
+        uint64_t* w = &A->bits[l][i >> 6];
+        uint64_t b = 1ULL << (i & 63);
+        if (!(__atomic_load_n(w, __ATOMIC_SEQ_CST) & b)) __atomic_fetch_or(w, b, __ATOMIC_SEQ_CST);
+    }
+    return (old & bit) == 0;
+}
+
+// Word c of level l - 1 was seen empty: clear its summary bit, and go on
+// up while that empties summary words
+static void vEBA_repair(vEBAtomic* A, int l, size_t c) {
+    for (; l < A->levels; c >>= 6, l++) {
+        size_t w = c >> 6;
+        uint64_t b = 1ULL << (c & 63);
+        uint32_t* ver = &A->version[l][w];
+        uint32_t v = __atomic_load_n(ver, __ATOMIC_SEQ_CST);
+        if ((v & 1) || !__atomic_compare_exchange_n(ver, &v, v + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            return; // another repair owns this word; the bit stays (stale) set
+        }
+        uint64_t left = __atomic_and_fetch(&A->bits[l][w], ~b, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&A->bits[l - 1][c], __ATOMIC_SEQ_CST) != 0) {
+            left = __atomic_or_fetch(&A->bits[l][w], b, __ATOMIC_SEQ_CST); // refilled meanwhile
+        }
+        __atomic_store_n(ver, v + 2, __ATOMIC_SEQ_CST);
+        if (left != 0) return;
+    }
+}
+
+// DELETE: returns 1 if x was removed, 0 if it was not present
+int vEBAtomic_delete(vEBAtomic* A, int x) {
+    if (x < 0 || x >= A->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, A->u);
+        return 0;
+    }
+    uint64_t bit = 1ULL << (x & 63);
+    uint64_t old = __atomic_fetch_and(&A->bits[0][x >> 6], ~bit, __ATOMIC_SEQ_CST);
+    if (!(old & bit)) return 0;
+    if ((old & ~bit) == 0) vEBA_repair(A, 1, (size_t)x >> 6);
+    return 1;
+}
+
+// SUCCESSOR: smallest key > x, or -1
+int vEBAtomic_successor(const vEBAtomic* A, int x) {
+    if (x >= A->u - 1) return -1;
+    if (x < -1) x = -1;
+    size_t i = (size_t)(x + 1); // first candidate position at level l
+    int l = 0;
+    for (;;) {
+        size_t w = i >> 6;
+        uint64_t word = (w < A->words[l]) ? vEBA_read(A, l, w) & (~0ULL << (i & 63)) : 0;
+        if (word) {
+            size_t pos = (w << 6) + (size_t)__builtin_ctzll(word);
+            if (l == 0) return (int)pos;
+            l--;               // search inside child word pos
+            i = pos << 6;
+        }
+        else {
+            if (l == A->levels - 1) return -1;
+            l++;               // nothing left in word w: continue after it one level up
+            i = w + 1;
+        }
+    }
+}
+
+// PREDECESSOR: largest key < x, or -1
+int vEBAtomic_predecessor(const vEBAtomic* A, int x) {
+    if (x <= 0) return -1;
+    if (x > A->u) x = A->u;
+    long i = (long)x - 1;      // last candidate position at level l
+    int l = 0;
+    for (;;) {
+        if (i < 0) {
+            // search ran off the front at this level
+            return -1;
+        }
+        size_t w = (size_t)i >> 6;
+        uint64_t word = vEBA_read(A, l, w) & (~0ULL >> (63 - (i & 63)));
+        if (word) {
+            size_t pos = (w << 6) + (size_t)(63 - __builtin_clzll(word));
+            if (l == 0) return (int)pos;
+            l--;
+            i = (long)(pos << 6) + 63;
+        }
+        else {
+            if (l == A->levels - 1) return -1;
+            l++;
+            i = (long)w - 1;
+        }
+    }
+}
+
+int vEBAtomic_min(const vEBAtomic* A) { return vEBAtomic_successor(A, -1); }
+int vEBAtomic_max(const vEBAtomic* A) { return vEBAtomic_predecessor(A, A->u); }
+
+// SHARDED TREE
+// vEBSharded splits the universe by its top k bits, the same high(x)
+// split vEB_create does at the root: shard s is an independent tree over
+// the keys s << shard_bits .. ((s + 1) << shard_bits) - 1, and a small
+// summary tree lists the non-empty shards so that successor/predecessor
+// can cross shard boundaries. Batch operations partition their keys by
+// shard (stable, so sorted input stays sorted per shard) and give each
+// worker thread its own set of shards, so threads never share a tree;
+// the summary is brought up to date afterwards. Single-key calls and
+// concurrent calls on the same container are not thread-safe.
+#define VEB_MAX_SHARD_BITS 16
+
+typedef struct vEBSharded {
+    int u;
+    int k;                 // log2 of the shard count
+    int shard_bits;        // log2 of the shard universe
+    vEBNode** shard;       // 2^k trees
+    vEBNode* summary;      // universe max(2, 2^k): non-empty shards
+} vEBSharded;
+
+// Create an empty container of size U with 2^k shards (0 <= k < log2 U,
+// k <= 16); flags are passed to vEB_create_ex for every shard.
+// Exits on invalid arguments or memory allocation failure
+vEBSharded* vEBSharded_create(int U, int k, unsigned flags) {
+    if (U < 2 || (U & (U - 1)) != 0 || k < 0 || k > VEB_MAX_SHARD_BITS || (1 << k) >= U) {
+        fprintf(stderr, "Error: U=%d, k=%d: need a power-of-two U and 0 <= k < log2(U), k <= %d\n",
+                U, k, VEB_MAX_SHARD_BITS);
+        exit(EXIT_FAILURE);
+    }
+    vEBSharded* S = (vEBSharded*)malloc(sizeof(vEBSharded));
+    if (!S) {
+        perror("malloc vEBSharded");
+        exit(EXIT_FAILURE);
+    }
+    S->u = U;
+    S->k = k;
+    S->shard_bits = log2_int(U) - k;
+    S->shard = (vEBNode**)malloc(sizeof(vEBNode*) << k);
+    if (!S->shard) {
+        perror("malloc vEBSharded shards");
+        exit(EXIT_FAILURE);
+    }
+    for (int s = 0; s < (1 << k); s++) S->shard[s] = vEB_create_ex(1 << S->shard_bits, flags);
+    S->summary = vEB_create_ex((k > 0) ? 1 << k : 2, flags);
+    return S;
+}
+
+void vEBSharded_free(vEBSharded* S) {
+    if (!S) return;
+    for (int s = 0; s < (1 << S->k); s++) vEB_free(S->shard[s]);
+    free(S->shard);
+    vEB_free(S->summary);
+    free(S);
+}
+
+static int vEBS_local(const vEBSharded* S, int x) { return x & ((1 << S->shard_bits) - 1); }
+
+int vEBSharded_member(vEBSharded* S, int x) {
+    if (x < 0 || x >= S->u) return 0;
+    return vEB_member(S->shard[x >> S->shard_bits], vEBS_local(S, x));
+}
+
+int vEBSharded_insert(vEBSharded* S, int x) {
+    if (x < 0 || x >= S->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, S->u);
+        return 0;
+    }
+    int s = x >> S->shard_bits;
+    int r = vEB_insert(S->shard[s], vEBS_local(S, x));
+    if (r) vEB_insert(S->summary, s);
+    return r;
+}
+
+int vEBSharded_delete(vEBSharded* S, int x) {
+    if (x < 0 || x >= S->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, S->u);
+        return 0;
+    }
+    int s = x >> S->shard_bits;
+    int r = vEB_delete(S->shard[s], vEBS_local(S, x));
+    if (r && S->shard[s]->min == -1) vEB_delete(S->summary, s);
+    return r;
+}
+
+int vEBSharded_min(vEBSharded* S) {
+    int s = S->summary->min;
+    return (s == -1) ? -1 : (s << S->shard_bits) | S->shard[s]->min;
+}
+
+int vEBSharded_max(vEBSharded* S) {
+    int s = S->summary->max;
+    return (s == -1) ? -1 : (s << S->shard_bits) | S->shard[s]->max;
+}
+
+int vEBSharded_successor(vEBSharded* S, int x) {
+    if (x < 0) return vEBSharded_min(S);
+    if (x >= S->u) return -1;
+    int s = x >> S->shard_bits;
+    int r = vEB_successor(S->shard[s], vEBS_local(S, x));
+    if (r != -1) return (s << S->shard_bits) | r;
+    s = vEB_successor(S->summary, s);
+    return (s == -1) ? -1 : (s << S->shard_bits) | S->shard[s]->min;
+}
+
+int vEBSharded_predecessor(vEBSharded* S, int x) {
+    if (x >= S->u) return vEBSharded_max(S);
+    if (x <= 0) return -1;
+    int s = x >> S->shard_bits;
+    int r = vEB_predecessor(S->shard[s], vEBS_local(S, x));
+    if (r != -1) return (s << S->shard_bits) | r;
+    s = vEB_predecessor(S->summary, s);
+    return (s == -1) ? -1 : (s << S->shard_bits) | S->shard[s]->max;
+}
+
+// One worker of a batch: shards first, first + stride, ...
+typedef struct vEBShardJob {
+    vEBSharded* S;
+    const int* local;      // keys grouped by shard, shard bits stripped
+    const int* start;      // shard s owns local[start[s] .. start[s + 1])
+    int first, stride;
+    int insert;            // 1 = insert batch, 0 = delete batch
+    int result;            // keys changed, or the first VEB_* error
+} vEBShardJob;
+
+static void* vEBS_run_job(void* arg) {
+    vEBShardJob* J = (vEBShardJob*)arg;
+    J->result = 0;
+    for (int s = J->first; s < (1 << J->S->k); s += J->stride) {
+        int n = J->start[s + 1] - J->start[s];
+        if (n == 0) continue;
+        const int* keys = J->local + J->start[s];
+        int r = J->insert ? vEB_insert_batch(J->S->shard[s], keys, n)
+                          : vEB_delete_batch(J->S->shard[s], keys, n);
+        if (r < 0) {
+            J->result = r;
+            break;
+        }
+        J->result += r;
+    }
+    return NULL;
+}
+
+// Run jobs[0..threads) on their own threads (jobs[0] on the caller's)
+static void vEBS_run_jobs(vEBShardJob* jobs, int threads) {
+    pthread_t* tid = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads);
+    char* started = (char*)calloc((size_t)threads, 1);
+    if (tid && started) {
+        for (int t = 1; t < threads; t++) {
+            started[t] = pthread_create(&tid[t], NULL, vEBS_run_job, &jobs[t]) == 0;
+        }
+    }
+    vEBS_run_job(&jobs[0]);
+    for (int t = 1; t < threads; t++) {
+        if (started && started[t]) pthread_join(tid[t], NULL);
+        else vEBS_run_job(&jobs[t]); // could not start a thread: do it here
+    }
+    free(tid);
+    free(started);
+}
+
+static int vEBS_batch(vEBSharded* S, const int* keys, int n, int threads, int insert) {
+    if (n < 0 || (n > 0 && !keys)) return VEB_EINVAL;
+    for (int i = 0; i < n; i++) {
+        if (keys[i] < 0 || keys[i] >= S->u) return VEB_ERANGE;
+    }
+    if (n == 0) return 0;
+    int shards = 1 << S->k;
+    if (threads < 1) threads = 1;
+    if (threads > shards) threads = shards;
+
+    // counting sort by shard; keeps the input order inside each shard
+    int* start = (int*)calloc((size_t)shards + 1, sizeof(int));
+    int* fill = (int*)malloc(sizeof(int) * (size_t)shards);
+    int* local = (int*)malloc(sizeof(int) * (size_t)n);
+    vEBShardJob* jobs = (vEBShardJob*)malloc(sizeof(vEBShardJob) * (size_t)threads);
+    int result = VEB_ENOMEM;
+    if (start && fill && local && jobs) {
+        for (int i = 0; i < n; i++) start[(keys[i] >> S->shard_bits) + 1]++;
+        for (int s = 0; s < shards; s++) {
+            start[s + 1] += start[s];
+            fill[s] = start[s];
+        }
+        for (int i = 0; i < n; i++) local[fill[keys[i] >> S->shard_bits]++] = vEBS_local(S, keys[i]);
+
+        for (int t = 0; t < threads; t++) {
+            jobs[t].S = S;
+            jobs[t].local = local;
+            jobs[t].start = start;
+            jobs[t].first = t;
+            jobs[t].stride = threads;
+            jobs[t].insert = insert;
+        }
+        vEBS_run_jobs(jobs, threads);
+
+        result = 0;
+        for (int t = 0; t < threads; t++) {
+            if (jobs[t].result < 0) result = jobs[t].result;
+            else if (result >= 0) result += jobs[t].result;
+        }
+        // bring the summary up to date for every shard the batch touched
+        for (int s = 0; s < shards; s++) {
+            if (start[s + 1] == start[s]) continue;
+            if (S->shard[s]->min != -1) vEB_insert(S->summary, s);
+            else vEB_delete(S->summary, s);
+        }
+    }
+    free(start);
+    free(fill);
+    free(local);
+    free(jobs);
+    return result;
+}
+
+// Insert n keys using up to `threads` threads; returns how many were new,
+// VEB_ERANGE/VEB_EINVAL (nothing inserted) or VEB_ENOMEM
+int vEBSharded_insert_batch(vEBSharded* S, const int* keys, int n, int threads) {
+    return vEBS_batch(S, keys, n, threads, 1);
+}
+
+// Delete n keys using up to `threads` threads; returns how many were present
+int vEBSharded_delete_batch(vEBSharded* S, const int* keys, int n, int threads) {
+    return vEBS_batch(S, keys, n, threads, 0);
+}
+
+// Queries only read, so a query batch is simply cut into one slice per thread
+typedef struct vEBShardQuery {
+    vEBSharded* S;
+    const int* xs;
+    int* out;
+    int n;
+    int succ;              // 1 = successor, 0 = predecessor
+} vEBShardQuery;
+
+static void* vEBS_run_query(void* arg) {
+    vEBShardQuery* Q = (vEBShardQuery*)arg;
+    for (int i = 0; i < Q->n; i++) {
+        Q->out[i] = Q->succ ? vEBSharded_successor(Q->S, Q->xs[i]) : vEBSharded_predecessor(Q->S, Q->xs[i]);
+    }
+    return NULL;
+}
+
+static void vEBS_query_batch(vEBSharded* S, const int* xs, int* out, int n, int threads, int succ) {
+    if (threads < 1) threads = 1;
+    if (threads > n) threads = (n > 0) ? n : 1;
+    vEBShardQuery* Q = (vEBShardQuery*)malloc(sizeof(vEBShardQuery) * (size_t)threads);
+    pthread_t* tid = (pthread_t*)malloc(sizeof(pthread_t) * (size_t)threads);
+    if (!Q || !tid) threads = 1; // fall back to the calling thread only
+    if (threads == 1) {
+        vEBShardQuery all = { S, xs, out, n, succ };
+        vEBS_run_query(&all);
+    }
+    else {
+        int per = (n + threads - 1) / threads;
+        for (int t = 0; t < threads; t++) {
+            int lo = t * per, hi = (lo + per < n) ? lo + per : n;
+            Q[t].S = S;
+            Q[t].xs = xs + lo;
+            Q[t].out = out + lo;
+            Q[t].n = (hi > lo) ? hi - lo : 0;
+            Q[t].succ = succ;
+        }
+        for (int t = 1; t < threads; t++) {
+            if (pthread_create(&tid[t], NULL, vEBS_run_query, &Q[t]) != 0) {
+                vEBS_run_query(&Q[t]);
+                Q[t].n = -1;   // already done, nothing to join
+            }
+        }
+        vEBS_run_query(&Q[0]);
+        for (int t = 1; t < threads; t++) {
+            if (Q[t].n >= 0) pthread_join(tid[t], NULL);
+        }
+    }
+    free(Q);
+    free(tid);
+}
+
+// out[i] = vEBSharded_successor(S, xs[i]), using up to `threads` threads
+void vEBSharded_successor_batch(vEBSharded* S, const int* xs, int* out, int n, int threads) {
+    vEBS_query_batch(S, xs, out, n, threads, 1);
+}
+
+// out[i] = vEBSharded_predecessor(S, xs[i]), using up to `threads` threads
+void vEBSharded_predecessor_batch(vEBSharded* S, const int* xs, int* out, int n, int threads) {
+    vEBS_query_batch(S, xs, out, n, threads, 0);
+}
+
+// 64-BIT KEYS
+// vEB64Node is the uint64_t-keyed variant: the universe is 2^bits with
+// 1 <= bits <= 64, so "empty" is a separate flag instead of a -1 sentinel.
+// It is always lazy: a node holding a single key owns no summary or
+// cluster array, and clusters are released as soon as they become empty.
+// Subtrees with bits <= 6 are single-word bitmap leaves.
+// A dense cluster array costs 8 * 2^(bits - bits/2) bytes per node, which
+// keeps it practical up to roughly 2^40; with VEB_HASHED each node keeps
+// only its non-empty clusters in a vEBHash, so space is O(n) for any bits.
+typedef struct vEB64Node {
+    unsigned char bits;    // log2 of the universe size
+    unsigned char lo_bits; // low(x) width; clusters span 2^lo_bits keys
+    unsigned char empty;   // 1 while the tree holds no keys
+    unsigned char flags;   // 0 or VEB_HASHED, inherited by every subtree
+    uint64_t min, max;     // valid only when !empty
+    union {
+        struct {
+            struct vEB64Node* summary;  // non-NULL iff the node holds >= 2 keys
+            union {
+                struct vEB64Node** cluster; // 2^(bits - lo_bits) entries, NULL = empty
+                struct vEBHash* table;      // VEB_HASHED
+            };
+        };
+        uint64_t leaf;     // bits <= 6: bit i set <=> key i present
+    };
+} vEB64Node;
+
+#define VEB64_LEAF_BITS 6
+
+static int vEB64_is_leaf(const vEB64Node* V) { return V->bits <= VEB64_LEAF_BITS; }
+static uint64_t high64(const vEB64Node* V, uint64_t x) { return x >> V->lo_bits; }
+static uint64_t low64(const vEB64Node* V, uint64_t x) { return x & ((1ULL << V->lo_bits) - 1); }
+static uint64_t idx64(const vEB64Node* V, uint64_t h, uint64_t l) { return (h << V->lo_bits) | l; }
+static uint64_t vEB64_clusters(const vEB64Node* V) { return 1ULL << (V->bits - V->lo_bits); }
+static int vEB64_in_range(const vEB64Node* V, uint64_t x) {
+    return V->bits == 64 || (x >> V->bits) == 0;
+}
+
+// Create an empty tree over [0, 2^bits); flags may be VEB_HASHED
+// Exits on invalid arguments or memory allocation failure
+vEB64Node* vEB64_create_ex(int bits, unsigned flags) {
+    if (bits < 1 || bits > 64) {
+        fprintf(stderr, "Error: bits=%d must be in [1, 64]\n", bits);
+        exit(EXIT_FAILURE);
+    }
+    if (flags & ~VEB_HASHED) {
+        fprintf(stderr, "Error: unsupported vEB64 flags 0x%x\n", flags & ~VEB_HASHED);
+        exit(EXIT_FAILURE);
+    }
+    vEB64Node* V = (vEB64Node*)malloc(sizeof(vEB64Node));
+    if (!V) {
+        perror("malloc vEB64Node");
+        exit(EXIT_FAILURE);
+    }
+    V->bits = (unsigned char)bits;
+    V->lo_bits = (unsigned char)(bits / 2);
+    V->empty = 1;
+    V->flags = (unsigned char)flags;
+    V->min = V->max = 0;
+    if (vEB64_is_leaf(V)) {
+        V->leaf = 0;
+    }
+    else {
+        V->summary = NULL;
+        V->cluster = NULL;
+    }
+    return V;
+}
+
+vEB64Node* vEB64_create(int bits) {
+    return vEB64_create_ex(bits, 0);
+}
+
+// Cluster h of V (which must hold >= 2 keys), or NULL when it is empty
+static vEB64Node* vEB64_cluster(vEB64Node* V, uint64_t h) {
+    if (V->flags & VEB_HASHED) return (vEB64Node*)vEBHash_get(V->table, h);
+    return V->cluster[h];
+}
+
+static void vEB64_add_cluster(vEB64Node* V, uint64_t h, vEB64Node* C) {
+    if (V->flags & VEB_HASHED) {
+        if (!vEBHash_put(&V->table, h, C)) {
+            perror("vEB64 cluster table");
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+    if (!V->cluster) {
+        V->cluster = (vEB64Node**)calloc(vEB64_clusters(V), sizeof(vEB64Node*));
+        if (!V->cluster) {
+            perror("calloc vEB64 cluster array");
+            exit(EXIT_FAILURE);
+        }
+    }
+    V->cluster[h] = C;
+}
+
+// Unlink and free the (empty) cluster h; a hashed table frees itself when
+// its last entry goes, the dense array is dropped together with the summary
+static void vEB64_drop_cluster(vEB64Node* V, uint64_t h) {
+    if (V->flags & VEB_HASHED) {
+        free(vEBHash_get(V->table, h));
+        vEBHash_remove(&V->table, h);
+    }
+    else {
+        free(V->cluster[h]);
+        V->cluster[h] = NULL;
+    }
+}
+
+// MEMBER
+int vEB64_member(vEB64Node* V, uint64_t x) {
+    if (!V || V->empty || !vEB64_in_range(V, x)) return 0;
+    if (vEB64_is_leaf(V)) return (int)((V->leaf >> x) & 1);
+    if (x == V->min || x == V->max) return 1;
+    if (!V->summary) return 0;
+    return vEB64_member(vEB64_cluster(V, high64(V, x)), low64(V, x));
+}
+
+// INSERT (duplicates are detected on the way down, no separate member call)
+static int vEB64_insert_rec(vEB64Node* V, uint64_t x) {
+    if (vEB64_is_leaf(V)) {
+        if ((V->leaf >> x) & 1) return 0;
+        V->leaf |= 1ULL << x;
+        if (V->empty || x < V->min) V->min = x;
+        if (V->empty || x > V->max) V->max = x;
+        V->empty = 0;
+        return 1;
+    }
+    if (V->empty) {
+        V->min = V->max = x;
+        V->empty = 0;
+        return 1;
+    }
+    if (x == V->min || x == V->max) return 0;
+    if (x < V->min) {
+        uint64_t tmp = x; x = V->min; V->min = tmp;
+    }
+    uint64_t h = high64(V, x), l = low64(V, x);
+    vEB64Node* C = V->summary ? vEB64_cluster(V, h) : NULL;
+    if (!C) {
+        C = vEB64_create_ex(V->lo_bits, V->flags);
+        vEB64_add_cluster(V, h, C);
+        if (!V->summary) V->summary = vEB64_create_ex(V->bits - V->lo_bits, V->flags);
+        vEB64_insert_rec(V->summary, h);
+    }
+    if (!vEB64_insert_rec(C, l)) return 0;
+    if (x > V->max) V->max = x;
+    return 1;
+}
+
+// Returns 1 if x was added, 0 if it was already present
+int vEB64_insert(vEB64Node* V, uint64_t x) {
+    if (!vEB64_in_range(V, x)) {
+        fprintf(stderr, "Error: Value %llu out of bounds (bits = %d)\n",
+                (unsigned long long)x, V->bits);
+        return 0;
+    }
+    return vEB64_insert_rec(V, x);
+}
+
+// SUCCESSOR: stores the smallest key > x in *out and returns 1, or returns 0
+int vEB64_successor(vEB64Node* V, uint64_t x, uint64_t* out) {
+    if (!V || V->empty) return 0;
+    if (x < V->min) {
+        *out = V->min;
+        return 1;
+    }
+    if (x >= V->max || !vEB64_in_range(V, x)) return 0;
+    if (vEB64_is_leaf(V)) {
+        // x < max <= 63, so the shift is defined
+        *out = (uint64_t)__builtin_ctzll(V->leaf & (~0ULL << x << 1));
+        return 1;
+    }
+    uint64_t h = high64(V, x), l = low64(V, x), off;
+    vEB64Node* C = vEB64_cluster(V, h);
+    if (C && l < C->max && vEB64_successor(C, l, &off)) {
+        *out = idx64(V, h, off);
+        return 1;
+    }
+    uint64_t succ_c;
+    if (!vEB64_successor(V->summary, h, &succ_c)) return 0;
+    *out = idx64(V, succ_c, vEB64_cluster(V, succ_c)->min);
+    return 1;
+}
+
+// PREDECESSOR: stores the largest key < x in *out and returns 1, or returns 0
+int vEB64_predecessor(vEB64Node* V, uint64_t x, uint64_t* out) {
+    if (!V || V->empty) return 0;
+    if (x > V->max) {
+        *out = V->max;
+        return 1;
+    }
+    if (x <= V->min) return 0;
+    if (vEB64_is_leaf(V)) {
+        // min < x <= 63
+        *out = (uint64_t)(63 - __builtin_clzll(V->leaf & ((1ULL << x) - 1)));
+        return 1;
+    }
+    uint64_t h = high64(V, x), l = low64(V, x), off;
+    vEB64Node* C = vEB64_cluster(V, h);
+    if (C && l > C->min && vEB64_predecessor(C, l, &off)) {
+        *out = idx64(V, h, off);
+        return 1;
+    }
+    uint64_t pred_c;
+    if (!vEB64_predecessor(V->summary, h, &pred_c)) {
+        *out = V->min;     // x > min was checked above
+        return 1;
+    }
+    *out = idx64(V, pred_c, vEB64_cluster(V, pred_c)->max);
+    return 1;
+}
+
+// DELETE (x must be present)
+static void vEB64_delete_rec(vEB64Node* V, uint64_t x) {
+    if (vEB64_is_leaf(V)) {
+        V->leaf &= ~(1ULL << x);
+        if (!V->leaf) {
+            V->empty = 1;
+            return;
+        }
+        V->min = (uint64_t)__builtin_ctzll(V->leaf);
+        V->max = (uint64_t)(63 - __builtin_clzll(V->leaf));
+        return;
+    }
+    if (V->min == V->max) {
+        V->empty = 1;
+        return;
+    }
+    if (x == V->min) {
+        uint64_t first = V->summary->min;
+        x = idx64(V, first, vEB64_cluster(V, first)->min);
+        V->min = x;
+    }
+    uint64_t h = high64(V, x), l = low64(V, x);
+    vEB64Node* C = vEB64_cluster(V, h);
+    vEB64_delete_rec(C, l);
+    if (C->empty) {
+        vEB64_drop_cluster(V, h);
+        vEB64_delete_rec(V->summary, h);
+        if (V->summary->empty) {
+            // back to a single key: drop the whole second level
+            free(V->summary);
+            if (!(V->flags & VEB_HASHED)) free(V->cluster);
+            V->summary = NULL;
+            V->cluster = NULL;
+        }
+        if (x == V->max) {
+            if (!V->summary) {
+                V->max = V->min;
+            }
+            else {
+                uint64_t smax = V->summary->max;
+                V->max = idx64(V, smax, vEB64_cluster(V, smax)->max);
+            }
+        }
+    }
+    else if (x == V->max) {
+        V->max = idx64(V, h, C->max);
+    }
+}
+
+// Returns 1 if x was removed, 0 if it was not present
+int vEB64_delete(vEB64Node* V, uint64_t x) {
+    if (!vEB64_in_range(V, x)) {
+        fprintf(stderr, "Error: Value %llu out of bounds (bits = %d)\n",
+                (unsigned long long)x, V->bits);
+        return 0;
+    }
+    if (!vEB64_member(V, x)) return 0;
+    vEB64_delete_rec(V, x);
+    return 1;
+}
+
+// FREE (walks the summary, so cost is proportional to the keys stored)
+void vEB64_free(vEB64Node* V) {
+    if (!V) return;
+    if (!vEB64_is_leaf(V) && V->summary) {
+        uint64_t h = V->summary->min;
+        do {
+            vEB64_free(vEB64_cluster(V, h));
+        } while (vEB64_successor(V->summary, h, &h));
+        if (V->flags & VEB_HASHED) free(V->table);
+        else free(V->cluster);
+        vEB64_free(V->summary);
+    }
+    free(V);
+}
+
+// KEY-VALUE MAP
+// vEBMap stores a void* value with every key, so successor/predecessor
+// return the key and its value in one descent instead of a tree query
+// followed by a separate lookup. An internal node keeps the values of its
+// min (which is in no cluster) and its max (a copy; the max is also in a
+// cluster), and a subtree with u <= 64 is a bitmap whose values sit in a
+// slot array packed by rank, so the cluster reached last on a query path
+// answers from its own fields. Like vEB64Node the map is always lazy and
+// releases clusters as soon as they become empty; the summary carries no
+// values and is a plain lazy vEBNode.
+#define VEB_MAP_LEAF_BITS 64
+
+typedef struct vEBMap {
+    int u;                 // universe size
+    int shift;             // log2(lower_sqrt); 0 for leaves
+    int min, max;          // -1 when empty
+    union {
+        struct {
+            void* min_val;
+            void* max_val;
+            struct vEBNode* summary;   // non-NULL iff the node holds >= 2 keys
+            struct vEBMap** cluster;   // upper_sqrt entries, NULL = empty
+        };
+        struct {
+            uint64_t bits;             // u <= 64: bit i set <=> key i present
+            void** vals;               // value of the r-th smallest key at vals[r]
+            int cap;                   // slots allocated in vals
+        };
+    };
+} vEBMap;
+
+static int vEBMap_is_leaf(const vEBMap* M) { return M->u <= VEB_MAP_LEAF_BITS; }
+static int vEBMap_clusters(const vEBMap* M) { return M->u >> M->shift; }
+
+// Slot of key x in a leaf: the number of smaller keys present
+static int vEBMap_rank(const vEBMap* M, int x) {
+    return __builtin_popcountll(M->bits & ((1ULL << x) - 1));
+}
+
+static void* vEBMap_min_val(const vEBMap* M) {
+    return vEBMap_is_leaf(M) ? M->vals[0] : M->min_val;
+}
+
+static void* vEBMap_max_val(const vEBMap* M) {
+    return vEBMap_is_leaf(M) ? M->vals[__builtin_popcountll(M->bits) - 1] : M->max_val;
+}
+
+static vEBMap* vEBMap_new(int U) {
+    vEBMap* M = (vEBMap*)malloc(sizeof(vEBMap));
+    if (!M) {
+        perror("malloc vEBMap");
+        exit(EXIT_FAILURE);
+    }
+    M->u = U;
+    M->min = M->max = -1;
+    if (U <= VEB_MAP_LEAF_BITS) {
+        M->shift = 0;
+        M->bits = 0;
+        M->vals = NULL;
+        M->cap = 0;
+    }
+    else {
+        M->shift = log2_int(U) / 2;
+        M->min_val = M->max_val = NULL;
+        M->summary = NULL;
+        M->cluster = NULL;
+    }
+    return M;
+}
+
+// Create an empty map over keys [0, U) (power of two ≥ 2)
+// Exits on invalid U or memory allocation failure
+vEBMap* vEBMap_create(int U) {
+    if (U < 2 || (U & (U - 1)) != 0) {
+        fprintf(stderr, "Error: U=%d must be a power of two ≥ 2\n", U);
+        exit(EXIT_FAILURE);
+    }
+    return vEBMap_new(U);
+}
+
+void vEBMap_free(vEBMap* M) {
+    if (!M) return;
+    if (vEBMap_is_leaf(M)) {
+        free(M->vals);
+    }
+    else if (M->summary) {
+        int h = vEB_min(M->summary);
+        do {
+            vEBMap_free(M->cluster[h]);
+        } while ((h = vEB_successor(M->summary, h)) != -1);
+        free(M->cluster);
+        vEB_free(M->summary);
+    }
+    free(M);
+}
+
+// GET: 1 and the value in *val (if val is not NULL) if x is present
+int vEBMap_get(const vEBMap* M, int x, void** val) {
+    if (x < 0 || x >= M->u) return 0;
+    while (!vEBMap_is_leaf(M)) {
+        if (M->min == -1 || x < M->min || x > M->max) return 0;
+        if (x == M->min || x == M->max) {
+            if (val) *val = (x == M->min) ? M->min_val : M->max_val;
+            return 1;
+        }
+        if (!M->summary) return 0;
+        const vEBMap* C = M->cluster[x >> M->shift];
+        if (!C) return 0;
+        x &= (1 << M->shift) - 1;
+        M = C;
+    }
+    if (!((M->bits >> x) & 1)) return 0;
+    if (val) *val = M->vals[vEBMap_rank(M, x)];
+    return 1;
+}
+
+// PUT: 1 if x was added, 0 if it was present (its value is replaced)
+static int vEBMap_put_rec(vEBMap* M, int x, void* val) {
+    if (vEBMap_is_leaf(M)) {
+        int r = vEBMap_rank(M, x);
+        if ((M->bits >> x) & 1) {
+            M->vals[r] = val;
+            return 0;
+        }
+        int n = __builtin_popcountll(M->bits);
+        if (n == M->cap) {
+            int cap = M->cap ? 2 * M->cap : 2;
+            void** vals = (void**)realloc(M->vals, (size_t)cap * sizeof(void*));
+            if (!vals) {
+                perror("realloc vEBMap slots");
+                exit(EXIT_FAILURE);
+            }
+            M->vals = vals;
+            M->cap = cap;
+        }
+        memmove(M->vals + r + 1, M->vals + r, (size_t)(n - r) * sizeof(void*));
+        M->vals[r] = val;
+        M->bits |= 1ULL << x;
+        if (M->min == -1 || x < M->min) M->min = x;
+        if (x > M->max) M->max = x;
+        return 1;
+    }
+    if (M->min == -1) {
+        M->min = M->max = x;
+        M->min_val = M->max_val = val;
+        return 1;
+    }
+    if (x == M->min || x == M->max) {
+        if (x == M->min) M->min_val = val;
+        if (x == M->max) M->max_val = val;
+        if (x == M->min) return 0;
+        // a max distinct from min is also stored in its cluster
+    }
+    if (x < M->min) {
+        int tmp = x; x = M->min; M->min = tmp;
+        void* tv = val; val = M->min_val; M->min_val = tv;
+    }
+    int h = x >> M->shift, l = x & ((1 << M->shift) - 1);
+    if (!M->summary) {
+        M->cluster = (vEBMap**)calloc((size_t)vEBMap_clusters(M), sizeof(vEBMap*));
+        if (!M->cluster) {
+            perror("calloc vEBMap cluster array");
+            exit(EXIT_FAILURE);
+        }
+        M->summary = vEB_create_ex(vEBMap_clusters(M), VEB_LAZY | VEB_FREE_EMPTY | VEB_BITMAP_LEAVES);
+    }
+    if (!M->cluster[h]) {
+        M->cluster[h] = vEBMap_new(1 << M->shift);
+        vEB_insert(M->summary, h);
+    }
+    int r = vEBMap_put_rec(M->cluster[h], l, val);
+    if (x > M->max) {
+        M->max = x;
+        M->max_val = val;
+    }
+    return r;
+}
+
+// Exits on memory allocation failure
+int vEBMap_put(vEBMap* M, int x, void* val) {
+    if (x < 0 || x >= M->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, M->u);
+        return 0;
+    }
+    return vEBMap_put_rec(M, x, val);
+}
+
+// MIN / MAX: the key (or -1), with its value in *val if val is not NULL
+int vEBMap_min(const vEBMap* M, void** val) {
+    if (M->min != -1 && val) *val = vEBMap_min_val(M);
+    return M->min;
+}
+
+int vEBMap_max(const vEBMap* M, void** val) {
+    if (M->max != -1 && val) *val = vEBMap_max_val(M);
+    return M->max;
+}
+
+// SUCCESSOR: smallest key > x (or -1), with its value in *val
+static int vEBMap_successor_rec(const vEBMap* M, int x, void** val) {
+    if (M->min == -1 || x >= M->max) return -1;
+    if (x < M->min) {
+        *val = vEBMap_min_val(M);
+        return M->min;
+    }
+    if (vEBMap_is_leaf(M)) {
+        // x < max <= 63, so the shift is defined
+        uint64_t word = M->bits & (~0ULL << x << 1);
+        int k = __builtin_ctzll(word);
+        *val = M->vals[vEBMap_rank(M, k)];
+        return k;
+    }
+    int h = x >> M->shift, l = x & ((1 << M->shift) - 1);
+    const vEBMap* C = M->cluster[h];
+    if (C && l < C->max) return (h << M->shift) | vEBMap_successor_rec(C, l, val);
+    int succ_c = vEB_successor(M->summary, h);  // exists: min <= x < max
+    C = M->cluster[succ_c];
+    *val = vEBMap_min_val(C);
+    return (succ_c << M->shift) | C->min;
+}
+
+int vEBMap_successor(const vEBMap* M, int x, void** val) {
+    if (x < 0) return vEBMap_min(M, val);
+    if (x >= M->u) return -1;
+    void* v;
+    int k = vEBMap_successor_rec(M, x, &v);
+    if (k != -1 && val) *val = v;
+    return k;
+}
+
+// PREDECESSOR: largest key < x (or -1), with its value in *val
+static int vEBMap_predecessor_rec(const vEBMap* M, int x, void** val) {
+    if (M->min == -1 || x <= M->min) return -1;
+    if (x > M->max) {
+        *val = vEBMap_max_val(M);
+        return M->max;
+    }
+    if (vEBMap_is_leaf(M)) {
+        // min < x <= 63
+        uint64_t word = M->bits & ((1ULL << x) - 1);
+        int k = 63 - __builtin_clzll(word);
+        *val = M->vals[vEBMap_rank(M, k)];
+        return k;
+    }
+    int h = x >> M->shift, l = x & ((1 << M->shift) - 1);
+    const vEBMap* C = M->cluster[h];
+    if (C && l > C->min) return (h << M->shift) | vEBMap_predecessor_rec(C, l, val);
+    int pred_c = vEB_predecessor(M->summary, h);
+    if (pred_c == -1) {
+        *val = M->min_val;  // x > min was checked above
+        return M->min;
+    }
+    C = M->cluster[pred_c];
+    *val = vEBMap_max_val(C);
+    return (pred_c << M->shift) | C->max;
+}
+
+int vEBMap_predecessor(const vEBMap* M, int x, void** val) {
+    if (x <= 0) return -1;
+    if (x >= M->u) return vEBMap_max(M, val);
+    void* v;
+    int k = vEBMap_predecessor_rec(M, x, &v);
+    if (k != -1 && val) *val = v;
+    return k;
+}
+
+// DELETE (x must be present); its value goes to *val
+static void vEBMap_delete_rec(vEBMap* M, int x, void** val) {
+    if (vEBMap_is_leaf(M)) {
+        int r = vEBMap_rank(M, x);
+        int n = __builtin_popcountll(M->bits);
+        *val = M->vals[r];
+        memmove(M->vals + r, M->vals + r + 1, (size_t)(n - r - 1) * sizeof(void*));
+        M->bits &= ~(1ULL << x);
+        if (!M->bits) {
+            free(M->vals);
+            M->vals = NULL;
+            M->cap = 0;
+            M->min = M->max = -1;
+            return;
+        }
+        M->min = __builtin_ctzll(M->bits);
+        M->max = 63 - __builtin_clzll(M->bits);
+        return;
+    }
+    if (M->min == M->max) {
+        *val = M->min_val;
+        M->min = M->max = -1;
+        M->min_val = M->max_val = NULL;
+        return;
+    }
+    void* promoted;
+    void** out = val;
+    if (x == M->min) {
+        // promote the smallest clustered key; its value moves up with it
+        *val = M->min_val;
+        int first = vEB_min(M->summary);
+        vEBMap* F = M->cluster[first];
+        x = (first << M->shift) | F->min;
+        M->min = x;
+        M->min_val = vEBMap_min_val(F);
+        out = &promoted;
+    }
+    int h = x >> M->shift, l = x & ((1 << M->shift) - 1);
+    vEBMap* C = M->cluster[h];
+    vEBMap_delete_rec(C, l, out);
+    if (C->min == -1) {
+        vEBMap_free(C);
+        M->cluster[h] = NULL;
+        vEB_delete(M->summary, h);
+        if (vEB_min(M->summary) == -1) {
+            // back to a single key: drop the whole second level
+            vEB_free(M->summary);
+            free(M->cluster);
+            M->summary = NULL;
+            M->cluster = NULL;
+        }
+        if (x == M->max) {
+            if (!M->summary) {
+                M->max = M->min;
+                M->max_val = M->min_val;
+            }
+            else {
+                int smax = vEB_max(M->summary);
+                M->max = (smax << M->shift) | M->cluster[smax]->max;
+                M->max_val = vEBMap_max_val(M->cluster[smax]);
+            }
+        }
+    }
+    else if (x == M->max) {
+        M->max = (h << M->shift) | C->max;
+        M->max_val = vEBMap_max_val(C);
+    }
+}
+
+// Returns 1 and the removed value in *val (if val is not NULL) if x was
+// present, 0 otherwise
+int vEBMap_delete(vEBMap* M, int x, void** val) {
+    if (x < 0 || x >= M->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, M->u);
+        return 0;
+    }
+    void* v;
+    if (!vEBMap_get(M, x, NULL)) return 0;
+    vEBMap_delete_rec(M, x, &v);
+    if (val) *val = v;
+    return 1;
+}
+
+// COMPACT LAYOUT
+// vEBCompact is the eager tree without pointers: one flat array of 8-byte
+// nodes. An internal node holds only min and max, and a subtree with
+// u <= 64 is a single 64-bit bitmap. Where a child lives follows from the
+// universe size alone, so the geometry is kept once per level (log2 u):
+// a node's summary starts right after it, and its clusters follow the
+// summary at a fixed stride. min/max are stored +1, so an all-zero array
+// is an empty tree and calloc'd pages are not touched until keys land.
+#define VEBC_LEAF_LG 6
+#define VEBC_MAX_LG 30
+
+typedef union vEBCompactNode {
+    struct {
+        uint32_t min1, max1;   // key + 1, 0 = empty
+    };
+    uint64_t bits;             // level <= VEBC_LEAF_LG: bit i set <=> key i present
+} vEBCompactNode;
+
+typedef struct vEBCompactLevel {
+    int lo, hi;                // low/high bit widths of the split (0 for leaves)
+    uint32_t size;             // nodes in a subtree of this level
+    uint32_t cluster_base;     // offset of cluster 0 from its parent (1 + summary size)
+    uint32_t cluster_stride;   // nodes per cluster subtree
+} vEBCompactLevel;
+
+typedef struct vEBCompact {
+    int u;
+    int lg;                    // log2(u)
+    vEBCompactNode* nodes;     // level[lg].size entries
+    vEBCompactLevel level[VEBC_MAX_LG + 1];
+    void* map;                 // snapshot mapping that holds nodes, or NULL if heap
+    size_t map_bytes;
+    int readonly;              // nodes may not be modified (read-only mapping)
+} vEBCompact;
+
+// Fill in the per-level geometry of a tree of size 2^lg
+static void vEBC_init_levels(vEBCompact* C, int lg) {
+    C->u = 1 << lg;
+    C->lg = lg;
+    C->map = NULL;
+    C->map_bytes = 0;
+    C->readonly = 0;
+    for (int l = 1; l <= lg; l++) {
+        vEBCompactLevel* L = &C->level[l];
+        if (l <= VEBC_LEAF_LG) {
+            L->lo = L->hi = 0;
+            L->size = 1;
+            L->cluster_base = L->cluster_stride = 0;
+            continue;
+        }
+        L->lo = l / 2;
+        L->hi = l - L->lo;
+        L->cluster_base = 1 + C->level[L->hi].size;
+        L->cluster_stride = C->level[L->lo].size;
+        L->size = L->cluster_base + (uint32_t)(1u << L->hi) * L->cluster_stride;
+    }
+}
+
+// Create an empty compact tree of size U (power of two, 2 <= U <= 2^30)
+// Exits on invalid U or memory allocation failure
+vEBCompact* vEBCompact_create(int U) {
+    if (U < 2 || (U & (U - 1)) != 0) {
+        fprintf(stderr, "Error: U=%d must be a power of two ≥ 2\n", U);
+        exit(EXIT_FAILURE);
+    }
+    vEBCompact* C = (vEBCompact*)malloc(sizeof(vEBCompact));
+    if (!C) {
+        perror("malloc vEBCompact");
+        exit(EXIT_FAILURE);
+    }
+    vEBC_init_levels(C, log2_int(U));
+    C->nodes = (vEBCompactNode*)calloc(C->level[C->lg].size, sizeof(vEBCompactNode));
+    if (!C->nodes) {
+        perror("calloc vEBCompact nodes");
+        exit(EXIT_FAILURE);
+    }
+    return C;
+}
+
+// Create an empty compact tree without printing or exiting: returns NULL
+// and stores VEB_EINVAL or VEB_ENOMEM in *err (if err is not NULL) on failure
+vEBCompact* vEBCompact_try_create(int U, int* err) {
+    int status = VEB_OK;
+    vEBCompact* C = NULL;
+    if (U < 2 || (U & (U - 1)) != 0) status = VEB_EINVAL;
+    else if (!(C = (vEBCompact*)malloc(sizeof(vEBCompact)))) status = VEB_ENOMEM;
+    else {
+        vEBC_init_levels(C, log2_int(U));
+        C->nodes = (vEBCompactNode*)calloc(C->level[C->lg].size, sizeof(vEBCompactNode));
+        if (!C->nodes) {
+            free(C);
+            C = NULL;
+            status = VEB_ENOMEM;
+        }
+    }
+    if (err) *err = status;
+    return C;
+}
+
+void vEBCompact_free(vEBCompact* C) {
+    if (!C) return;
+    if (C->map) munmap(C->map, C->map_bytes);
+    else free(C->nodes);
+    free(C);
+}
+
+// Offset of cluster h of the node at off (level lg)
+static uint32_t vEBC_cluster(const vEBCompact* C, uint32_t off, int lg, int h) {
+    const vEBCompactLevel* L = &C->level[lg];
+    return off + L->cluster_base + (uint32_t)h * L->cluster_stride;
+}
+
+static int vEBC_min(const vEBCompact* C, uint32_t off, int lg) {
+    const vEBCompactNode* n = &C->nodes[off];
+    if (lg <= VEBC_LEAF_LG) return n->bits ? __builtin_ctzll(n->bits) : -1;
+    return (int)n->min1 - 1;
+}
+
+static int vEBC_max(const vEBCompact* C, uint32_t off, int lg) {
+    const vEBCompactNode* n = &C->nodes[off];
+    if (lg <= VEBC_LEAF_LG) return n->bits ? 63 - __builtin_clzll(n->bits) : -1;
+    return (int)n->max1 - 1;
+}
+
+int vEBCompact_min(const vEBCompact* C) { return vEBC_min(C, 0, C->lg); }
+int vEBCompact_max(const vEBCompact* C) { return vEBC_max(C, 0, C->lg); }
+
+// MEMBER (member only ever descends into clusters, so it is a plain loop)
+int vEBCompact_member(const vEBCompact* C, int x) {
+    if (x < 0 || x >= C->u) return 0;
+    uint32_t off = 0;
+    int lg = C->lg;
+    while (lg > VEBC_LEAF_LG) {
+        const vEBCompactNode* n = &C->nodes[off];
+        if (n->min1 == 0) return 0;
+        if ((uint32_t)x + 1 == n->min1 || (uint32_t)x + 1 == n->max1) return 1;
+        const vEBCompactLevel* L = &C->level[lg];
+        off = vEBC_cluster(C, off, lg, x >> L->lo);
+        x &= (1 << L->lo) - 1;
+        lg = L->lo;
+    }
+    return (int)((C->nodes[off].bits >> x) & 1);
+}
+
+// INSERT
+static int vEBC_insert(vEBCompact* C, uint32_t off, int lg, int x) {
+    vEBCompactNode* n = &C->nodes[off];
+    if (lg <= VEBC_LEAF_LG) {
+        if ((n->bits >> x) & 1) return 0;
+        n->bits |= 1ULL << x;
+        return 1;
+    }
+    if (n->min1 == 0) {
+        n->min1 = n->max1 = (uint32_t)x + 1;
+        return 1;
+    }
+    if ((uint32_t)x + 1 == n->min1 || (uint32_t)x + 1 == n->max1) return 0;
+    if ((uint32_t)x + 1 < n->min1) {
+        int tmp = x; x = (int)n->min1 - 1; n->min1 = (uint32_t)tmp + 1;
+    }
+    const vEBCompactLevel* L = &C->level[lg];
+    int h = x >> L->lo, l = x & ((1 << L->lo) - 1);
+    uint32_t coff = vEBC_cluster(C, off, lg, h);
+    if (vEBC_min(C, coff, L->lo) == -1) vEBC_insert(C, off + 1, L->hi, h);
+    if (!vEBC_insert(C, coff, L->lo, l)) return 0;
+    if ((uint32_t)x + 1 > n->max1) n->max1 = (uint32_t)x + 1;
+    return 1;
+}
+
+// Returns 1 if x was added, 0 if it was already present
+int vEBCompact_insert(vEBCompact* C, int x) {
+    if (x < 0 || x >= C->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, C->u);
+        return 0;
+    }
+    if (C->readonly) {
+        fprintf(stderr, "Error: compact tree is a read-only snapshot\n");
+        return 0;
+    }
+    return vEBC_insert(C, 0, C->lg, x);
+}
+
+// SUCCESSOR
+static int vEBC_successor(const vEBCompact* C, uint32_t off, int lg, int x) {
+    if (lg <= VEBC_LEAF_LG) {
+        if (x >= 63) return -1;
+        uint64_t word = C->nodes[off].bits & (~0ULL << (x + 1));
+        return word ? __builtin_ctzll(word) : -1;
+    }
+    int min = vEBC_min(C, off, lg);
+    if (min != -1 && x < min) return min;
+    const vEBCompactLevel* L = &C->level[lg];
+    int h = x >> L->lo, l = x & ((1 << L->lo) - 1);
+    uint32_t coff = vEBC_cluster(C, off, lg, h);
+    int max_low = vEBC_max(C, coff, L->lo);
+    if (max_low != -1 && l < max_low) {
+        return (h << L->lo) | vEBC_successor(C, coff, L->lo, l);
+    }
+    int succ_c = vEBC_successor(C, off + 1, L->hi, h);
+    if (succ_c == -1) return -1;
+    return (succ_c << L->lo) | vEBC_min(C, vEBC_cluster(C, off, lg, succ_c), L->lo);
+}
+
+int vEBCompact_successor(const vEBCompact* C, int x) {
+    if (x < 0) return vEBCompact_min(C);
+    if (x >= C->u) return -1;
+    return vEBC_successor(C, 0, C->lg, x);
+}
+
+// PREDECESSOR
+static int vEBC_predecessor(const vEBCompact* C, uint32_t off, int lg, int x) {
+    if (lg <= VEBC_LEAF_LG) {
+        if (x <= 0) return -1;
+        uint64_t word = C->nodes[off].bits & (~0ULL >> (64 - x));
+        return word ? 63 - __builtin_clzll(word) : -1;
+    }
+    int max = vEBC_max(C, off, lg);
+    if (max != -1 && x > max) return max;
+    const vEBCompactLevel* L = &C->level[lg];
+    int h = x >> L->lo, l = x & ((1 << L->lo) - 1);
+    uint32_t coff = vEBC_cluster(C, off, lg, h);
+    int min_low = vEBC_min(C, coff, L->lo);
+    if (min_low != -1 && l > min_low) {
+        return (h << L->lo) | vEBC_predecessor(C, coff, L->lo, l);
+    }
+    int pred_c = vEBC_predecessor(C, off + 1, L->hi, h);
+    if (pred_c == -1) {
+        int min = vEBC_min(C, off, lg);
+        if (min != -1 && x > min) return min;
+        return -1;
+    }
+    return (pred_c << L->lo) | vEBC_max(C, vEBC_cluster(C, off, lg, pred_c), L->lo);
+}
+
+int vEBCompact_predecessor(const vEBCompact* C, int x) {
+    if (x <= 0) return -1;
+    if (x >= C->u) return vEBCompact_max(C);
+    return vEBC_predecessor(C, 0, C->lg, x);
+}
+
+// DELETE (x must be present)
+static void vEBC_delete(vEBCompact* C, uint32_t off, int lg, int x) {
+    vEBCompactNode* n = &C->nodes[off];
+    if (lg <= VEBC_LEAF_LG) {
+        n->bits &= ~(1ULL << x);
+        return;
+    }
+    if (n->min1 == n->max1) {
+        n->min1 = n->max1 = 0;
+        return;
+    }
+    const vEBCompactLevel* L = &C->level[lg];
+    if ((uint32_t)x + 1 == n->min1) {
+        int first = vEBC_min(C, off + 1, L->hi);
+        x = (first << L->lo) | vEBC_min(C, vEBC_cluster(C, off, lg, first), L->lo);
+        n->min1 = (uint32_t)x + 1;
+    }
+    int h = x >> L->lo, l = x & ((1 << L->lo) - 1);
+    uint32_t coff = vEBC_cluster(C, off, lg, h);
+    vEBC_delete(C, coff, L->lo, l);
+    if (vEBC_min(C, coff, L->lo) == -1) {
+        vEBC_delete(C, off + 1, L->hi, h);
+        if ((uint32_t)x + 1 == n->max1) {
+            int smax = vEBC_max(C, off + 1, L->hi);
+            n->max1 = (smax == -1) ? n->min1
+                : (uint32_t)((smax << L->lo) | vEBC_max(C, vEBC_cluster(C, off, lg, smax), L->lo)) + 1;
+        }
+    }
+    else if ((uint32_t)x + 1 == n->max1) {
+        n->max1 = (uint32_t)((h << L->lo) | vEBC_max(C, coff, L->lo)) + 1;
+    }
+}
+
+// Returns 1 if x was removed, 0 if it was not present
+int vEBCompact_delete(vEBCompact* C, int x) {
+    if (x < 0 || x >= C->u) {
+        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, C->u);
+        return 0;
+    }
+    if (C->readonly) {
+        fprintf(stderr, "Error: compact tree is a read-only snapshot\n");
+        return 0;
+    }
+    if (!vEBCompact_member(C, x)) return 0;
+    vEBC_delete(C, 0, C->lg, x);
+    return 1;
+}
+
+// BATCH MEMBER (SIMD)
+// All queries of a compact tree descend through the same sequence of
+// levels, and a node is found by offset arithmetic alone, so membership
+// vectorizes directly: per level, gather min/max for 8 (AVX2) or 16
+// (AVX-512) keys, retire lanes that hit or reach an empty node, then step
+// every lane to its cluster with the level's base/stride. The leaf word is
+// gathered as the 32-bit half holding the key's bit. Every key in [0, u)
+// has a valid path, so finished lanes can keep walking harmlessly; they
+// are only masked out of the gathers. The kernel is chosen once at run
+// time from the CPU's features.
+static void vEBC_member_scalar(const vEBCompact* C, const int* xs, unsigned char* out, int n) {
+    for (int i = 0; i < n; i++) out[i] = (unsigned char)vEBCompact_member(C, xs[i]);
+}
+
+#ifdef VEB_HAVE_X86_KERNELS
+__attribute__((target("avx2")))
+static void vEBC_member_avx2(const vEBCompact* C, const int* xs, unsigned char* out, int n) {
+    const int* words = (const int*)C->nodes;  // node i = words 2i (min1 / low bits), 2i+1
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i u = _mm256_set1_epi32(C->u);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(xs + i));
+        __m256i live = _mm256_andnot_si256(_mm256_cmpgt_epi32(zero, x), _mm256_cmpgt_epi32(u, x));
+        __m256i found = zero;
+        __m256i off = zero;
+        x = _mm256_and_si256(x, live);
+        int lg = C->lg;
+        while (lg > VEBC_LEAF_LG && !_mm256_testz_si256(live, live)) {
+            const vEBCompactLevel* L = &C->level[lg];
+            __m256i at = _mm256_slli_epi32(off, 1);
+            __m256i mn = _mm256_mask_i32gather_epi32(zero, words, at, live, 4);
+            __m256i mx = _mm256_mask_i32gather_epi32(zero, words, _mm256_add_epi32(at, one), live, 4);
+            __m256i x1 = _mm256_add_epi32(x, one);
+            __m256i hit = _mm256_and_si256(live, _mm256_or_si256(_mm256_cmpeq_epi32(x1, mn),
+                                                                  _mm256_cmpeq_epi32(x1, mx)));
+            found = _mm256_or_si256(found, hit);
+            live = _mm256_andnot_si256(_mm256_or_si256(hit, _mm256_cmpeq_epi32(mn, zero)), live);
+            __m256i h = _mm256_srli_epi32(x, L->lo);
+            off = _mm256_add_epi32(off, _mm256_add_epi32(_mm256_set1_epi32((int)L->cluster_base),
+                                        _mm256_mullo_epi32(h, _mm256_set1_epi32((int)L->cluster_stride))));
+            x = _mm256_and_si256(x, _mm256_set1_epi32((1 << L->lo) - 1));
+            lg = L->lo;
+        }
+        if (lg <= VEBC_LEAF_LG) {
+            __m256i at = _mm256_add_epi32(_mm256_slli_epi32(off, 1), _mm256_srli_epi32(x, 5));
+            __m256i w = _mm256_mask_i32gather_epi32(zero, words, at, live, 4);
+            __m256i bit = _mm256_sllv_epi32(one, _mm256_and_si256(x, _mm256_set1_epi32(31)));
+            __m256i set = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(w, bit), zero), live);
+            found = _mm256_or_si256(found, set);
+        }
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(found));
+        for (int j = 0; j < 8; j++) out[i + j] = (unsigned char)((mask >> j) & 1);
+    }
+    vEBC_member_scalar(C, xs + i, out + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void vEBC_member_avx512(const vEBCompact* C, const int* xs, unsigned char* out, int n) {
+    const int* words = (const int*)C->nodes;
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi32(1);
+    // the unmasked shifts and conversions start from an undefined vector,
+    // which g++ -Wall reports as maybe-uninitialized; the zero-masked forms
+    // over all lanes compute the same thing from zero
+    const __mmask16 all = 0xFFFF;
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(xs + i));
+        // unsigned compare also rejects negative keys
+        __mmask16 live = _mm512_cmplt_epu32_mask(x, _mm512_set1_epi32(C->u));
+        __mmask16 found = 0;
+        __m512i off = zero;
+        x = _mm512_maskz_mov_epi32(live, x);
+        int lg = C->lg;
+        while (lg > VEBC_LEAF_LG && live) {
+            const vEBCompactLevel* L = &C->level[lg];
+            __m512i at = _mm512_maskz_slli_epi32(all, off, 1);
+            __m512i mn = _mm512_mask_i32gather_epi32(zero, live, at, words, 4);
+            __m512i mx = _mm512_mask_i32gather_epi32(zero, live, _mm512_add_epi32(at, one), words, 4);
+            __m512i x1 = _mm512_add_epi32(x, one);
+            __mmask16 hit = _mm512_mask_cmpeq_epi32_mask(live, x1, mn) | _mm512_mask_cmpeq_epi32_mask(live, x1, mx);
+            found |= hit;
+            live &= (__mmask16)~hit & _mm512_cmpneq_epi32_mask(mn, zero);
+            __m512i h = _mm512_maskz_srli_epi32(all, x, (unsigned)L->lo);
+            off = _mm512_add_epi32(off, _mm512_add_epi32(_mm512_set1_epi32((int)L->cluster_base),
+                                        _mm512_mullo_epi32(h, _mm512_set1_epi32((int)L->cluster_stride))));
+            x = _mm512_and_si512(x, _mm512_set1_epi32((1 << L->lo) - 1));
+            lg = L->lo;
+        }
+        if (lg <= VEBC_LEAF_LG) {
+            __m512i at = _mm512_add_epi32(_mm512_maskz_slli_epi32(all, off, 1), _mm512_maskz_srli_epi32(all, x, 5));
+            __m512i w = _mm512_mask_i32gather_epi32(zero, live, at, words, 4);
+            __m512i bit = _mm512_maskz_sllv_epi32(all, one, _mm512_and_si512(x, _mm512_set1_epi32(31)));
+            found |= _mm512_mask_test_epi32_mask(live, w, bit);
+        }
+        _mm_storeu_si128((__m128i*)(out + i), _mm512_maskz_cvtepi32_epi8(found, one));
+    }
+    vEBC_member_scalar(C, xs + i, out + i, n - i);
+}
+#endif
+
+typedef void (*vEBC_member_kernel)(const vEBCompact*, const int*, unsigned char*, int);
+
+static vEBC_member_kernel vEBC_pick_member_kernel(void) {
+#ifdef VEB_HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return vEBC_member_avx512;
+    if (__builtin_cpu_supports("avx2")) return vEBC_member_avx2;
+#endif
+    return vEBC_member_scalar;
+}
+
+// out[i] = vEBCompact_member(C, xs[i]) for i < n
+void vEBCompact_member_batch(const vEBCompact* C, const int* xs, unsigned char* out, int n) {
+    // batch callers may run in parallel: every thread picks the same kernel,
+    // and relaxed atomics make the racing first stores well defined
+    static vEBC_member_kernel kernel = NULL;
+    vEBC_member_kernel k = __atomic_load_n(&kernel, __ATOMIC_RELAXED);
+    if (!k) {
+        k = vEBC_pick_member_kernel();
+        __atomic_store_n(&kernel, k, __ATOMIC_RELAXED);
+    }
+    k(C, xs, out, n);
+}
+
+// SNAPSHOTS
+// A snapshot file is an image of a compact tree: a 32-byte header and the
+// node array exactly as it sits in memory. Since the layout has no
+// pointers, opening a snapshot maps the file and points nodes at it; there
+// is nothing to deserialize, and processes that map the same file share
+// one page-cache copy. The header records the byte order so that a file
+// from a machine of the other endianness is rejected instead of misread.
+// Runs of all-zero (empty) nodes are not written, which keeps the file
+// sparse on file systems that support holes.
+#define VEBC_MAGIC "vEBCMPT"
+#define VEBC_VERSION 1
+#define VEBC_BYTE_ORDER 0x01020304u
+#define VEBC_SAVE_CHUNK 512        // nodes per write (one 4 KiB page)
+
+typedef struct vEBCompactHeader {
+    char magic[8];             // VEBC_MAGIC, NUL-padded
+    uint32_t version;
+    uint32_t byte_order;       // VEBC_BYTE_ORDER as written by the saving machine
+    uint32_t lg;               // log2(u)
+    uint32_t reserved;
+    uint64_t nodes;            // node count that follows the header
+} vEBCompactHeader;
+
+// Write n bytes at offset off, retrying short writes
+static int vEBC_write_all(int fd, const void* buf, size_t n, off_t off) {
+    const char* p = (const char*)buf;
+    while (n > 0) {
+        ssize_t w = pwrite(fd, p, n, off);
+        if (w <= 0) return 0;
+        p += w;
+        off += w;
+        n -= (size_t)w;
+    }
+    return 1;
+}
+
+static char* vEB_path_with(const char* path, const char* suffix) {
+    size_t n = strlen(path), m = strlen(suffix);
+    char* s = (char*)malloc(n + m + 1);
+    if (!s) return NULL;
+    memcpy(s, path, n);
+    memcpy(s + n, suffix, m + 1);
+    return s;
+}
+
+// Directory part of path ("." if there is none)
+static char* vEB_dir_of(const char* path) {
+    const char* slash = strrchr(path, '/');
+    if (!slash) return vEB_path_with(".", "");
+    size_t n = (slash == path) ? 1 : (size_t)(slash - path);
+    char* s = (char*)malloc(n + 1);
+    if (!s) return NULL;
+    memcpy(s, path, n);
+    s[n] = '\0';
+    return s;
+}
+
+// Write C to path in place and flush it to disk; 1 on success
+static int vEBC_write_file(const vEBCompact* C, const char* path) {
+    vEBCompactHeader H;
+    memset(&H, 0, sizeof(H));
+    memcpy(H.magic, VEBC_MAGIC, sizeof(VEBC_MAGIC));
+    H.version = VEBC_VERSION;
+    H.byte_order = VEBC_BYTE_ORDER;
+    H.lg = (uint32_t)C->lg;
+    H.nodes = C->level[C->lg].size;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return 0;
+    uint64_t bytes = sizeof(H) + H.nodes * sizeof(vEBCompactNode);
+    int ok = ftruncate(fd, (off_t)bytes) == 0 && vEBC_write_all(fd, &H, sizeof(H), 0);
+    for (uint64_t i = 0; ok && i < H.nodes; i += VEBC_SAVE_CHUNK) {
+        uint64_t n = H.nodes - i < VEBC_SAVE_CHUNK ? H.nodes - i : VEBC_SAVE_CHUNK;
+        uint64_t j = 0;
+        while (j < n && C->nodes[i + j].bits == 0) j++;
+        if (j == n) continue;  // ftruncate already reads back as zeros
+        ok = vEBC_write_all(fd, C->nodes + i, n * sizeof(vEBCompactNode),
+                            (off_t)(sizeof(H) + i * sizeof(vEBCompactNode)));
+    }
+    if (ok && fsync(fd) != 0) ok = 0;
+    if (close(fd) != 0) ok = 0;
+    return ok;
+}
+
+// Write C to tmp_path, rename it over path and sync dir_path, so a reader
+// that has path mapped keeps the old image and a crash leaves either the
+// old or the new file. Returns VEB_OK or VEB_EIO (path is left untouched
+// unless the rename happened)
+static int vEBC_replace_file(const vEBCompact* C, const char* path,
+                             const char* tmp_path, const char* dir_path) {
+    if (!vEBC_write_file(C, tmp_path)) {
+        unlink(tmp_path);
+        return VEB_EIO;
+    }
+    if (rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return VEB_EIO;
+    }
+    int dir = open(dir_path, O_RDONLY);
+    if (dir < 0) return VEB_EIO;
+    int synced = fsync(dir) == 0;
+    close(dir);
+    return synced ? VEB_OK : VEB_EIO;
+}
+
+// Save C to path, replacing any existing file, and flush it to disk.
+// The file is written as <path>.tmp and renamed into place, so processes
+// that have the old snapshot mapped keep reading it unchanged.
+// Returns VEB_OK, VEB_ENOMEM, or VEB_EIO if the file cannot be written
+int vEBCompact_save(const vEBCompact* C, const char* path) {
+    char* tmp_path = vEB_path_with(path, ".tmp");
+    char* dir_path = vEB_dir_of(path);
+    int rc = (tmp_path && dir_path) ? vEBC_replace_file(C, path, tmp_path, dir_path) : VEB_ENOMEM;
+    free(tmp_path);
+    free(dir_path);
+    return rc;
+}
+
+// Map the snapshot at path. A writable mapping is private: changes go to
+// copy-on-write pages and never reach the file.
+static vEBCompact* vEBC_open(const char* path, int writable, int* err) {
+    int e = VEB_OK;
+    vEBCompact* C = NULL;
+    void* map = MAP_FAILED;
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) e = VEB_EIO;
+    else if ((uint64_t)st.st_size < sizeof(vEBCompactHeader)) e = VEB_EFORMAT;
+    else {
+        map = writable ? mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)
+                       : mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) e = VEB_EIO;
+    }
+    if (e == VEB_OK) {
+        const vEBCompactHeader* H = (const vEBCompactHeader*)map;
+        C = (vEBCompact*)malloc(sizeof(vEBCompact));
+        if (!C) e = VEB_ENOMEM;
+        else if (memcmp(H->magic, VEBC_MAGIC, sizeof(VEBC_MAGIC)) != 0
+                 || H->version != VEBC_VERSION || H->byte_order != VEBC_BYTE_ORDER
+                 || H->lg < 1 || H->lg > VEBC_MAX_LG) {
+            e = VEB_EFORMAT;
+        }
+        else {
+            vEBC_init_levels(C, (int)H->lg);
+            if (H->nodes != C->level[C->lg].size
+                || (uint64_t)st.st_size != sizeof(*H) + H->nodes * sizeof(vEBCompactNode)) {
+                e = VEB_EFORMAT;
+            }
+        }
+    }
+    if (fd >= 0) close(fd);    // the mapping stays valid without the descriptor
+    if (e != VEB_OK) {
+        if (map != MAP_FAILED) munmap(map, (size_t)st.st_size);
+        free(C);
+        if (err) *err = e;
+        return NULL;
+    }
+    C->nodes = (vEBCompactNode*)((char*)map + sizeof(vEBCompactHeader));
+    C->map = map;
+    C->map_bytes = (size_t)st.st_size;
+    C->readonly = !writable;
+    if (err) *err = VEB_OK;
+    return C;
+}
+
+// Map the snapshot at path read-only. Queries run directly on the mapped
+// pages; insert and delete are refused. Free with vEBCompact_free.
+// Returns NULL and sets *err (if given) to VEB_EIO, VEB_EFORMAT or VEB_ENOMEM
+vEBCompact* vEBCompact_open_mmap(const char* path, int* err) {
+    return vEBC_open(path, 0, err);
+}
+
+static int vEB_save_visit(int key, void* ctx) {
+    vEBC_insert((vEBCompact*)ctx, 0, ((vEBCompact*)ctx)->lg, key);
+    return 0;
+}
+
+// Save the keys of V as a compact snapshot, to be opened with
+// vEBCompact_open_mmap. Returns VEB_OK, VEB_EINVAL, VEB_ENOMEM or VEB_EIO
+int vEB_save(vEBNode* V, const char* path) {
+    if (!V || V->u < 2) return VEB_EINVAL;
+    int rc;
+    vEBCompact* C = vEBCompact_try_create(V->u, &rc);
+    if (!C) return rc;
+    vEB_for_each_in_range(V, 0, V->u - 1, vEB_save_visit, C);
+    rc = vEBCompact_save(C, path);
+    vEBCompact_free(C);
+    return rc;
 }
 
-// SUCCESSOR / PREDECESSOR helpers
-static int vEB_min(vEBNode* V) { return V->min; }
-static int vEB_max(vEBNode* V) { return V->max; }
+// DELTA LOG
+// vEBStore keeps a snapshot up to date without rewriting it on every
+// change. The base snapshot is mapped privately (copy-on-write) and every
+// insert or delete that changes the set is appended to <path>.log as an
+// 8-byte record. Opening the store maps the base and replays the log.
+// Compaction writes the current set to <path>.tmp, renames it over the
+// base and empties the log. It runs on its own once the log reaches
+// 1/VEB_STORE_COMPACT_DIV of the image size, so replay stays bounded and
+// every record costs a small constant share of one rewrite.
+// Replaying a log onto a base that already contains it gives the same set,
+// because each key ends up as its last record says. So a crash between
+// the rename and the log truncation loses nothing; the directory is synced
+// in between, so the truncation never reaches the disk without the rename.
+// A torn record at the end of the log (from a crash mid-append) is dropped
+// on open.
+#define VEB_LOG_INSERT 1
+#define VEB_LOG_DELETE 2
+#define VEB_STORE_COMPACT_DIV 8
 
-// SUCCESSOR
-int vEB_successor(vEBNode* V, int x) {
-    if (V->u <= 2) {
-        if (x == 0 && V->max == 1) return 1;
-        return -1;
+typedef struct vEBLogRecord {
+    uint32_t key;
+    uint32_t op;               // VEB_LOG_INSERT or VEB_LOG_DELETE
+} vEBLogRecord;
+
+typedef struct vEBStore {
+    vEBCompact* tree;          // mapped base plus replayed changes
+    char* path;                // base snapshot
+    char* log_path;            // path + ".log"
+    char* tmp_path;            // path + ".tmp", written during compaction
+    char* dir_path;            // directory holding path, synced after the rename
+    int log_fd;
+    uint64_t log_records;      // records in the log
+    uint64_t compact_at;       // log_records that trigger a compaction, 0 = never
+    uint64_t compact_every;    // log_records between compactions (and between retries)
+    int log_torn;              // a partial record could not be cut off the log
+} vEBStore;
+
+void vEBStore_free(vEBStore* S) {
+    if (!S) return;
+    if (S->log_fd >= 0) close(S->log_fd);
+    vEBCompact_free(S->tree);
+    free(S->path);
+    free(S->log_path);
+    free(S->tmp_path);
+    free(S->dir_path);
+    free(S);
+}
+
+// Apply the records of the open log to S->tree and drop a torn tail
+static int vEBStore_replay(vEBStore* S) {
+    struct stat st;
+    if (fstat(S->log_fd, &st) != 0) return VEB_EIO;
+    uint64_t n = (uint64_t)st.st_size / sizeof(vEBLogRecord);
+    vEBLogRecord buf[VEBC_SAVE_CHUNK];
+    for (uint64_t i = 0; i < n; ) {
+        uint64_t want = n - i < VEBC_SAVE_CHUNK ? n - i : VEBC_SAVE_CHUNK;
+        ssize_t r = pread(S->log_fd, buf, want * sizeof(vEBLogRecord),
+                          (off_t)(i * sizeof(vEBLogRecord)));
+        if (r < (ssize_t)sizeof(vEBLogRecord)) return VEB_EIO;
+        uint64_t got = (uint64_t)r / sizeof(vEBLogRecord);
+        for (uint64_t j = 0; j < got; j++) {
+            if (buf[j].key >= (uint32_t)S->tree->u) return VEB_EFORMAT;
+            int x = (int)buf[j].key;
+            if (buf[j].op == VEB_LOG_INSERT) vEBC_insert(S->tree, 0, S->tree->lg, x);
+            else if (buf[j].op != VEB_LOG_DELETE) return VEB_EFORMAT;
+            else if (vEBCompact_member(S->tree, x)) vEBC_delete(S->tree, 0, S->tree->lg, x);
+        }
+        i += got;
     }
-    if (V->min != -1 && x < V->min) return V->min;
-    int h = high(V, x), l = low(V, x);
-    int max_low = vEB_max(V->cluster[h]);
-    if (max_low != -1 && l < max_low) {
-        int off = vEB_successor(V->cluster[h], l);
-        return idx(V, h, off);
+    if ((uint64_t)st.st_size != n * sizeof(vEBLogRecord)
+        && ftruncate(S->log_fd, (off_t)(n * sizeof(vEBLogRecord))) != 0) {
+        return VEB_EIO;
     }
-    int succ_c = vEB_successor(V->summary, h);
-    if (succ_c == -1) return -1;
-    int off = vEB_min(V->cluster[succ_c]);
-    return idx(V, succ_c, off);
+    S->log_records = n;
+    return VEB_OK;
 }
 
-// PREDECESSOR
-int vEB_predecessor(vEBNode* V, int x) {
-    if (V->u <= 2) {
-        if (x == 1 && V->min == 0) return 0;
-        return -1;
+// Open the store at path, creating an empty one of size U if the base
+// snapshot does not exist yet (U is ignored otherwise)
+// Returns NULL and sets *err (if given) to VEB_EINVAL, VEB_ENOMEM, VEB_EIO
+// or VEB_EFORMAT on failure
+vEBStore* vEBStore_open(const char* path, int U, int* err) {
+    int e = VEB_OK;
+    vEBStore* S = (vEBStore*)calloc(1, sizeof(vEBStore));
+    if (!S) {
+        if (err) *err = VEB_ENOMEM;
+        return NULL;
     }
-    if (V->max != -1 && x > V->max) return V->max;
-    int h = high(V, x), l = low(V, x);
-    int min_low = vEB_min(V->cluster[h]);
-    if (min_low != -1 && l > min_low) {
-        int off = vEB_predecessor(V->cluster[h], l);
-        return idx(V, h, off);
+    S->log_fd = -1;
+    S->path = vEB_path_with(path, "");
+    S->log_path = vEB_path_with(path, ".log");
+    S->tmp_path = vEB_path_with(path, ".tmp");
+    S->dir_path = vEB_dir_of(path);
+    if (!S->path || !S->log_path || !S->tmp_path || !S->dir_path) e = VEB_ENOMEM;
+    if (e == VEB_OK && access(path, F_OK) != 0) {
+        if (U < 2 || U > (1 << VEBC_MAX_LG) || (U & (U - 1)) != 0) e = VEB_EINVAL;
+        else {
+            vEBCompact* C = vEBCompact_try_create(U, &e);
+            if (C) {
+                e = vEBCompact_save(C, path);
+                vEBCompact_free(C);
+                unlink(S->log_path);   // a log without its base is stale
+            }
+        }
     }
-    int pred_c = vEB_predecessor(V->summary, h);
-    if (pred_c == -1) {
-        if (V->min != -1 && x > V->min) return V->min;
-        return -1;
+    if (e == VEB_OK) S->tree = vEBC_open(path, 1, &e);
+    if (e == VEB_OK) {
+        S->log_fd = open(S->log_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+        e = (S->log_fd < 0) ? VEB_EIO : vEBStore_replay(S);
     }
-    int off = vEB_max(V->cluster[pred_c]);
-    return idx(V, pred_c, off);
+    if (e != VEB_OK) {
+        vEBStore_free(S);
+        if (err) *err = e;
+        return NULL;
+    }
+    S->compact_every = (uint64_t)S->tree->map_bytes / VEB_STORE_COMPACT_DIV / sizeof(vEBLogRecord);
+    if (S->compact_every == 0) S->compact_every = 1;
+    S->compact_at = S->compact_every;
+    if (err) *err = VEB_OK;
+    return S;
 }
 
-// DELETE
-void vEB_delete(vEBNode* V, int x) {
-
-    if (x < 0 || x >= V->u) {
-        fprintf(stderr, "Error: Value %d out of bounds (U = %d)\n", x, V->u);
-        return;
+// Write the current set as the new base and empty the log
+// Returns VEB_OK or VEB_EIO (the store stays usable on the old base)
+int vEBStore_compact(vEBStore* S) {
+    // the rename must be on disk before the log is emptied, or a crash
+    // could bring back the old base without the records that updated it
+    int e = vEBC_replace_file(S->tree, S->path, S->tmp_path, S->dir_path);
+    if (e != VEB_OK) return e;
+    // remap the new base so the copy-on-write pages of the old one are dropped
+    vEBCompact* fresh = vEBC_open(S->path, 1, &e);
+    if (fresh) {
+        vEBCompact_free(S->tree);
+        S->tree = fresh;
     }
+    if (ftruncate(S->log_fd, 0) != 0) return VEB_EIO;
+    S->log_records = 0;
+    S->log_torn = 0;
+    S->compact_at = S->compact_every;
+    return VEB_OK;
+}
 
-    if (V->min == V->max) {
-        V->min = V->max = -1;
-        return;
-    }
-    if (V->u == 2) {
-        V->min = V->max = (x == 0) ? 1 : 0;
-        return;
-    }
-    if (x == V->min) {
-        int first = vEB_min(V->summary);
-        int off = vEB_min(V->cluster[first]);
-        x = idx(V, first, off);
-        V->min = x;
+// Append one record; returns VEB_OK or VEB_EIO. A failed write is cut
+// back off, so a later record never lands behind a partial one; if even
+// that fails, nothing is appended until a compaction has emptied the log.
+static int vEBStore_append(vEBStore* S, int x, uint32_t op) {
+    vEBLogRecord rec = { (uint32_t)x, op };
+    if (S->log_torn && vEBStore_compact(S) != VEB_OK) return VEB_EIO;
+    if (write(S->log_fd, &rec, sizeof(rec)) != (ssize_t)sizeof(rec)) {
+        if (ftruncate(S->log_fd, (off_t)(S->log_records * sizeof(vEBLogRecord))) != 0) S->log_torn = 1;
+        return VEB_EIO;
     }
-    int h = high(V, x), l = low(V, x);
-    vEB_delete(V->cluster[h], l);
-    if (vEB_min(V->cluster[h]) == -1) {
-        vEB_delete(V->summary, h);
-        if (x == V->max) {
-            int smax = vEB_max(V->summary);
-            V->max = (smax == -1) ? V->min : idx(V, smax, vEB_max(V->cluster[smax]));
+    S->log_records++;
+    return VEB_OK;
+}
+
+// Compact once the log is long enough. The change that got here is
+// already logged and applied, so a failure is VEB_ECOMPACT, and the next
+// attempt waits another compact_every records instead of rewriting the
+// base on every change.
+static int vEBStore_compact_due(vEBStore* S) {
+    if (S->log_records < S->compact_at) return VEB_OK;
+    if (vEBStore_compact(S) == VEB_OK) return VEB_OK;
+    S->compact_at = S->log_records + S->compact_every;
+    return VEB_ECOMPACT;
+}
+
+// The record is appended before the tree changes, so the tree never holds
+// a change the log does not have.
+// Returns 1 if x was added, 0 if it was already present (nothing is
+// logged), VEB_ERANGE, VEB_EIO (not logged, the set is unchanged) or
+// VEB_ECOMPACT (x was added and logged; the store keeps its old base)
+int vEBStore_insert(vEBStore* S, int x) {
+    if (x < 0 || x >= S->tree->u) return VEB_ERANGE;
+    if (vEBCompact_member(S->tree, x)) return 0;
+    int e = vEBStore_append(S, x, VEB_LOG_INSERT);
+    if (e != VEB_OK) return e;
+    vEBC_insert(S->tree, 0, S->tree->lg, x);
+    e = vEBStore_compact_due(S);
+    return e == VEB_OK ? 1 : e;
+}
+
+// Returns 1 if x was removed, 0 if it was not present (nothing is
+// logged), VEB_ERANGE, VEB_EIO (not logged, the set is unchanged) or
+// VEB_ECOMPACT (x was removed and logged; the store keeps its old base)
+int vEBStore_delete(vEBStore* S, int x) {
+    if (x < 0 || x >= S->tree->u) return VEB_ERANGE;
+    if (!vEBCompact_member(S->tree, x)) return 0;
+    int e = vEBStore_append(S, x, VEB_LOG_DELETE);
+    if (e != VEB_OK) return e;
+    vEBC_delete(S->tree, 0, S->tree->lg, x);
+    e = vEBStore_compact_due(S);
+    return e == VEB_OK ? 1 : e;
+}
+
+// Flush appended records to disk. Returns VEB_OK or VEB_EIO
+int vEBStore_sync(vEBStore* S) {
+    return fsync(S->log_fd) == 0 ? VEB_OK : VEB_EIO;
+}
+
+// The current set; query it with the vEBCompact_* functions
+const vEBCompact* vEBStore_tree(const vEBStore* S) { return S->tree; }
+
+// MEMORY FOOTPRINT
+// Sizes are the bytes requested from malloc; glibc adds about 16 bytes of
+// header per allocation. A vEBCompact is one calloc, so pages that
+// never received a key are address space without being resident.
+
+// Bytes currently allocated by tree V (nodes, cluster arrays, hash tables)
+size_t vEB_memory_usage(vEBNode* V) {
+    if (!V) return 0;
+    size_t bytes = vEB_node_bytes(V);
+#ifdef VEB_STATS
+    if (V->stats && V->stats->root == V) bytes += sizeof(vEBStatsBlock);
+#endif
+    if (vEB_is_leaf(V) || V->u <= 2) return bytes;
+    if (V->flags & VEB_HASHED) {
+        if (V->table) {
+            vEBHashSlot* s = vEBHash_slots(V->table);
+            for (uint32_t i = 0; i < V->table->cap; i++) {
+                if (s[i].val) bytes += vEB_memory_usage((vEBNode*)s[i].val);
+            }
         }
     }
-    else if (x == V->max) {
-        V->max = idx(V, h, vEB_max(V->cluster[h]));
+    else if (V->cluster) {
+        for (int i = 0; i < V->upper_sqrt; i++) bytes += vEB_memory_usage(V->cluster[i]);
     }
+    return bytes + vEB_memory_usage(V->summary);
 }
 
-// FREE
-void vEB_free(vEBNode* V) {
-    if (!V) return;
+// Bytes of C: the node array (or the whole mapping of a snapshot) and the header
+size_t vEBCompact_memory_usage(const vEBCompact* C) {
+    if (!C) return 0;
+    if (C->map) return sizeof(vEBCompact) + C->map_bytes;
+    return sizeof(vEBCompact) + (size_t)C->level[C->lg].size * sizeof(vEBCompactNode);
+}
 
-    if (V->cluster) {
-        for (int i = 0; i < V->upper_sqrt; i++) {
-            vEB_free(V->cluster[i]);
+// Hash table bytes of a node with c clusters
+static double vEB_estimate_table(double c) {
+    if (c < 0.5) return 0;
+    double cap = VEB_HASH_MIN_CAP;
+    while (c * 4 > cap * 3) cap *= 2;
+    return sizeof(vEBHash) + cap * sizeof(vEBHashSlot);
+}
+
+// Expected bytes of a lazy subtree of universe U holding n >= 1 uniformly
+// random keys. Below its min the keys fall into clusters about like a
+// Poisson process, so a cluster holds k of them with probability
+// e^-m m^k / k! (m = keys per cluster); dense nodes just use the mean.
+static double vEB_estimate_lazy(int U, unsigned flags, double n) {
+    double bytes = sizeof(vEBNode);
+    if (((flags & VEB_BITMAP_LEAVES) && U <= VEB_LEAF_BITS) || U <= 2) return bytes;
+    int lg = log2_int(U), half = lg / 2;
+    int upper = 1 << (lg - half), lower = 1 << half;
+    if (!(flags & VEB_HASHED)) bytes += (double)vEB_cluster_array_bytes(upper, flags);
+    double rest = n - 1;
+    if (rest < 0.5) return bytes;
+    double m = rest / upper, c;
+    if (m >= 32) {
+        c = upper;
+        bytes += c * vEB_estimate_lazy(lower, flags, m);
+    }
+    else {
+        c = upper * (1 - exp(-m));
+        double p = exp(-m);  // P(0 keys)
+        for (int k = 1; k <= (int)(m + 6 * sqrt(m)) + 8; k++) {
+            p *= m / k;
+            bytes += upper * p * vEB_estimate_lazy(lower, flags, k);
         }
-        free(V->cluster);
     }
+    if (flags & VEB_HASHED) bytes += vEB_estimate_table(c);
+    return bytes + vEB_estimate_lazy(upper, flags, c < 1 ? 1 : c);
+}
 
-    vEB_free(V->summary);
-    free(V);
+// Bytes a structure of universe U built with flags needs for n keys.
+// Eager and arena trees and VEB_COMPACT do not depend on n, and their
+// figure is exact. For VEB_LAZY (with or without VEB_HASHED) it is the
+// expectation for uniformly random keys; clustered keys need less.
+// Returns 0 for invalid arguments
+uint64_t vEB_estimate_memory(int U, unsigned flags, int n) {
+    if (n < 0) return 0;
+    if (flags == VEB_COMPACT) {
+        if (U < 2 || (U & (U - 1)) != 0) return 0;
+        vEBCompact C;
+        vEBC_init_levels(&C, log2_int(U));
+        return sizeof(vEBCompact) + (uint64_t)C.level[C.lg].size * sizeof(vEBCompactNode);
+    }
+    if (vEB_check_args(U, flags)) return 0;
+    uint64_t extra = 0;
+#ifdef VEB_STATS
+    extra = sizeof(vEBStatsBlock);
+#endif
+    if (!(flags & VEB_LAZY)) return extra + vEB_arena_bytes(U, flags);
+    double keys = (n < U) ? n : U;
+    return extra + (uint64_t)vEB_estimate_lazy(U, flags, keys > 0 ? keys : 1);
 }
+
+// Tests and example usage (define VEB_NO_MAIN to compile the tree into
+// another program without them)
+#ifndef VEB_NO_MAIN
 // 빈 트리 상태에서 작업: 트리가 비어있을 때, 다양한 연산이 잘 동작하는지 확인
 void testcase_empty_tree() {
     vEBNode* tree = vEB_create(16);
@@ -542,7 +4823,935 @@ void testcase_insert_delete_sequence_state() {
     vEB_free(tree);
 }
 
-// Example usage
+// 지연 할당 트리: 삽입 전에는 summary/cluster가 할당되지 않고, 동작은 eager 트리와 같아야 함
+void testcase_lazy_tree() {
+    int U = 1 << 20;
+    vEBNode* tree = vEB_create_ex(U, VEB_LAZY);
+
+    // 생성 직후에는 summary와 cluster가 비어있음
+    printf("Summary allocated before insert? %d\n", tree->summary != NULL); // 0
+    printf("Cluster[0] allocated before insert? %d\n", tree->cluster[0] != NULL); // 0
+    printf("Empty lazy tree: Successor of 5? %d\n", vEB_successor(tree, 5)); // -1
+
+    vEB_insert(tree, 3);
+    vEB_insert(tree, 70000);
+    vEB_insert(tree, 1000000);
+    printf("Member 70000: %d\n", vEB_member(tree, 70000)); // 1
+    printf("Member 69999: %d\n", vEB_member(tree, 69999)); // 0
+    printf("Successor of 3: %d\n", vEB_successor(tree, 3)); // 70000
+    printf("Predecessor of 1000000: %d\n", vEB_predecessor(tree, 1000000)); // 70000
+
+    vEB_delete(tree, 70000);
+    printf("After delete 70000, Successor of 3: %d\n", vEB_successor(tree, 3)); // 1000000
+    vEB_free(tree);
+}
+
+// VEB_FREE_EMPTY: 비게 된 cluster는 삭제 시 해제되어야 함
+void testcase_lazy_free_empty() {
+    vEBNode* tree = vEB_create_ex(256, VEB_LAZY | VEB_FREE_EMPTY);
+
+    vEB_insert(tree, 1);
+    vEB_insert(tree, 200);
+    int h = 200 / tree->lower_sqrt;
+    printf("Cluster of 200 allocated? %d\n", tree->cluster[h] != NULL); // 1
+
+    vEB_delete(tree, 200);
+    printf("Cluster of 200 after delete? %d\n", tree->cluster[h] != NULL); // 0
+    printf("Summary after delete? %d\n", tree->summary != NULL); // 0
+    printf("Min: %d, Max: %d\n", tree->min, tree->max); // 1, 1
+
+    vEB_insert(tree, 200);
+    printf("Successor of 1: %d\n", vEB_successor(tree, 1)); // 200
+    vEB_free(tree);
+}
+
+// 비트맵 leaf: U <= VEB_LEAF_BITS 인 서브트리는 비트맵 하나로 표현됨
+void testcase_bitmap_leaves() {
+    vEBNode* leaf = vEB_create_ex(64, VEB_BITMAP_LEAVES);
+    vEB_insert(leaf, 0);
+    vEB_insert(leaf, 37);
+    vEB_insert(leaf, 63);
+    printf("Leaf bits: %llx\n", (unsigned long long)leaf->bits[0]); // 8000002000000001
+    printf("Successor of 0: %d\n", vEB_successor(leaf, 0)); // 37
+    printf("Predecessor of 63: %d\n", vEB_predecessor(leaf, 63)); // 37
+    vEB_delete(leaf, 0);
+    printf("After delete 0, Min: %d, Max: %d\n", leaf->min, leaf->max); // 37, 63
+    vEB_free(leaf);
+
+    // leaf 아래로 재귀하지 않는 큰 트리 (lazy와 조합)
+    vEBNode* tree = vEB_create_ex(1 << 16, VEB_LAZY | VEB_BITMAP_LEAVES);
+    for (int i = 0; i < 1 << 16; i += 1000) {
+        vEB_insert(tree, i);
+    }
+    printf("Member 64000: %d\n", vEB_member(tree, 64000)); // 1
+    printf("Member 64001: %d\n", vEB_member(tree, 64001)); // 0
+    printf("Successor of 1000: %d\n", vEB_successor(tree, 1000)); // 2000
+    printf("Predecessor of 1000: %d\n", vEB_predecessor(tree, 1000)); // 0
+    vEB_delete(tree, 2000);
+    printf("After delete 2000, Successor of 1000: %d\n", vEB_successor(tree, 1000)); // 3000
+    vEB_free(tree);
+}
+
+// shift/mask 분해: lg(U)가 홀수일 때 lower_sqrt = 2^(lg/2), upper_sqrt = 2^(lg - lg/2)
+void testcase_shift_mask_geometry() {
+    vEBNode* tree = vEB_create_ex(1 << 15, VEB_LAZY);
+    printf("lower_sqrt: %d, upper_sqrt: %d\n", tree->lower_sqrt, tree->upper_sqrt); // 128, 256
+    printf("shift: %d, mask: %d\n", tree->shift, tree->mask); // 7, 127
+
+    vEB_insert(tree, 32767);
+    vEB_insert(tree, 128);
+    vEB_insert(tree, 127);
+    printf("Successor of 127: %d\n", vEB_successor(tree, 127)); // 128
+    printf("Predecessor of 32767: %d\n", vEB_predecessor(tree, 32767)); // 128
+    vEB_free(tree);
+}
+
+// 64비트 키: 2^30을 넘는 universe와 최대 키 근처 값의 동작 확인
+void testcase_veb64() {
+    vEB64Node* tree = vEB64_create(40);
+    uint64_t top = (1ULL << 40) - 1, out = 0;
+
+    printf("Empty: Member 5? %d\n", vEB64_member(tree, 5)); // 0
+    printf("Empty: Successor found? %d\n", vEB64_successor(tree, 5, &out)); // 0
+
+    vEB64_insert(tree, 7);
+    vEB64_insert(tree, 1ULL << 35);
+    vEB64_insert(tree, top);
+    printf("Member 2^35: %d\n", vEB64_member(tree, 1ULL << 35)); // 1
+    vEB64_successor(tree, 7, &out);
+    printf("Successor of 7: %llu\n", (unsigned long long)out); // 34359738368
+    vEB64_predecessor(tree, top, &out);
+    printf("Predecessor of 2^40-1: %llu\n", (unsigned long long)out); // 34359738368
+    printf("Successor of 2^40-1 found? %d\n", vEB64_successor(tree, top, &out)); // 0
+
+    vEB64_delete(tree, 1ULL << 35);
+    vEB64_successor(tree, 7, &out);
+    printf("After delete 2^35, Successor of 7: %llu\n", (unsigned long long)out); // 1099511627775
+    vEB64_free(tree);
+
+    // 전체 64비트 universe: 최대 키 UINT64_MAX도 유효한 키
+    vEB64Node* full = vEB64_create(64);
+    vEB64_insert(full, UINT64_MAX);
+    printf("Member UINT64_MAX: %d\n", vEB64_member(full, UINT64_MAX)); // 1
+    printf("Predecessor of UINT64_MAX found? %d\n", vEB64_predecessor(full, UINT64_MAX, &out)); // 0
+    vEB64_successor(full, 0, &out);
+    printf("Successor of 0: %llu\n", (unsigned long long)out); // 18446744073709551615
+    vEB64_free(full);
+}
+
+// 해시 cluster: 비어있지 않은 cluster만 해시 테이블에 저장됨
+void testcase_hashed_clusters() {
+    vEBNode* tree = vEB_create_ex(1 << 30, VEB_LAZY | VEB_HASHED | VEB_FREE_EMPTY);
+    printf("Table before insert? %d\n", tree->table != NULL); // 0
+
+    vEB_insert(tree, 5);
+    vEB_insert(tree, 1 << 20);
+    vEB_insert(tree, (1 << 30) - 1);
+    printf("Root table entries: %u\n", tree->table->used); // 2
+    printf("Successor of 5: %d\n", vEB_successor(tree, 5)); // 1048576
+    printf("Predecessor of 2^30-1: %d\n", vEB_predecessor(tree, (1 << 30) - 1)); // 1048576
+
+    vEB_delete(tree, 1 << 20);
+    printf("Root table entries after delete: %u\n", tree->table->used); // 1
+    printf("Member 2^20: %d\n", vEB_member(tree, 1 << 20)); // 0
+    vEB_free(tree);
+
+    // 64비트 universe에 여러 키: 루트 cluster 배열(2^32개) 없이 동작
+    vEB64Node* big = vEB64_create_ex(64, VEB_HASHED);
+    uint64_t out = 0;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        vEB64_insert(big, i * 0x9E3779B97F4A7C15ULL);
+    }
+    printf("Member 500*phi: %d\n", vEB64_member(big, 500 * 0x9E3779B97F4A7C15ULL)); // 1
+    printf("Member 500*phi+1: %d\n", vEB64_member(big, 500 * 0x9E3779B97F4A7C15ULL + 1)); // 0
+    vEB64_successor(big, 0, &out);
+    printf("Successor of 0: %llu\n", (unsigned long long)out); // 13523998650116618
+    vEB64_free(big);
+}
+
+// arena 트리: 모든 노드가 하나의 블록에 순회 순서대로 배치되고, 동작은 eager 트리와 같아야 함
+void testcase_arena_tree() {
+    vEBNode* tree = vEB_create_ex(1 << 12, VEB_ARENA);
+    vEBNode* ref = vEB_create(1 << 12);
+
+    // 블록 내 배치: 루트 바로 뒤에 summary가 위치
+    printf("Summary follows root: %d\n", (char*)tree->summary == (char*)tree + sizeof(vEBNode)); // 1
+
+    int mismatches = 0;
+    for (int i = 0; i < 4096; i += 7) {
+        vEB_insert(tree, i);
+        vEB_insert(ref, i);
+    }
+    for (int i = 0; i < 4096; i += 21) {
+        vEB_delete(tree, i);
+        vEB_delete(ref, i);
+    }
+    for (int i = 0; i < 4096; i++) {
+        if (vEB_member(tree, i) != vEB_member(ref, i)) mismatches++;
+        if (vEB_successor(tree, i) != vEB_successor(ref, i)) mismatches++;
+        if (vEB_predecessor(tree, i) != vEB_predecessor(ref, i)) mismatches++;
+    }
+    printf("Mismatches against eager tree: %d\n", mismatches); // 0
+    printf("Successor of 7: %d\n", vEB_successor(tree, 7)); // 14
+
+    vEB_free(tree);  // 블록 하나만 해제
+    vEB_free(ref);
+}
+
+// compact 레이아웃: 포인터 없이 8바이트 노드 배열로 eager 트리와 같은 결과를 내야 함
+void testcase_compact_tree() {
+    int U = 1 << 16;
+    vEBCompact* tree = vEBCompact_create(U);
+    vEBNode* ref = vEB_create_ex(U, VEB_LAZY);
+
+    printf("Node size: %d bytes\n", (int)sizeof(vEBCompactNode)); // 8
+    printf("Node count: %u\n", tree->level[tree->lg].size); // 4627
+    printf("Empty: Min: %d, Max: %d\n", vEBCompact_min(tree), vEBCompact_max(tree)); // -1, -1
+
+    for (int i = 0; i < U; i += 37) {
+        vEBCompact_insert(tree, i);
+        vEB_insert(ref, i);
+    }
+    for (int i = 0; i < U; i += 111) {
+        vEBCompact_delete(tree, i);
+        vEB_delete(ref, i);
+    }
+    int mismatches = 0;
+    for (int i = 0; i < U; i++) {
+        if (vEBCompact_member(tree, i) != vEB_member(ref, i)) mismatches++;
+        if (vEBCompact_successor(tree, i) != vEB_successor(ref, i)) mismatches++;
+        if (vEBCompact_predecessor(tree, i) != vEB_predecessor(ref, i)) mismatches++;
+    }
+    printf("Mismatches against pointer tree: %d\n", mismatches); // 0
+    printf("Min: %d, Max: %d\n", vEBCompact_min(tree), vEBCompact_max(tree)); // 37, 65527
+    printf("Successor of 37: %d\n", vEBCompact_successor(tree, 37)); // 74
+
+    vEBCompact_free(tree);
+    vEB_free(ref);
+}
+
+// 삽입 결과 반환: 새로 추가되면 1, 이미 있으면 0 (한 번의 하강으로 판별)
+void testcase_insert_reports_new() {
+    vEBNode* tree = vEB_create(16);
+    printf("Insert 5: %d\n", vEB_insert(tree, 5)); // 1
+    printf("Insert 5 again: %d\n", vEB_insert(tree, 5)); // 0
+    printf("Insert 3: %d\n", vEB_insert(tree, 3)); // 1
+    printf("Insert 5 (now inside a cluster): %d\n", vEB_insert(tree, 5)); // 0
+    printf("Insert 9: %d\n", vEB_insert(tree, 9)); // 1
+    printf("Insert 9 again: %d\n", vEB_insert(tree, 9)); // 0
+    printf("Min: %d, Max: %d\n", tree->min, tree->max); // 3, 9
+    vEB_free(tree);
+
+    // 비트맵 leaf, 64비트, compact 트리도 같은 의미
+    vEBNode* leafy = vEB_create_ex(1 << 10, VEB_LAZY | VEB_BITMAP_LEAVES);
+    int added = 0;
+    for (int i = 0; i < 300; i++) {
+        added += vEB_insert(leafy, (i * 7) % 100);
+    }
+    printf("Distinct keys added: %d\n", added); // 100
+    vEB_free(leafy);
+
+    vEB64Node* t64 = vEB64_create(48);
+    int first = vEB64_insert(t64, 1ULL << 40);
+    int again = vEB64_insert(t64, 1ULL << 40);
+    printf("vEB64 insert, again: %d, %d\n", first, again); // 1, 0
+    vEB64_free(t64);
+
+    vEBCompact* c = vEBCompact_create(1 << 12);
+    first = vEBCompact_insert(c, 4000);
+    again = vEBCompact_insert(c, 4000);
+    printf("Compact insert, again: %d, %d\n", first, again); // 1, 0
+    vEBCompact_free(c);
+}
+
+// 오류 코드 API: 출력이나 exit 없이 상태 코드로 실패를 알림
+void testcase_error_codes() {
+    int err = VEB_OK;
+    vEBNode* bad = vEB_try_create(6, 0, &err);
+    printf("try_create(6): %s, %s\n", bad ? "tree" : "NULL", vEB_strerror(err)); // NULL, invalid universe size or flags
+    bad = vEB_try_create(16, VEB_HASHED, &err);
+    printf("try_create(16, VEB_HASHED): %s, %d\n", bad ? "tree" : "NULL", err); // NULL, -2
+
+    vEBNode* tree = vEB_try_create(16, VEB_LAZY | VEB_FREE_EMPTY, &err);
+    printf("try_create(16, lazy): %s, %d\n", tree ? "tree" : "NULL", err); // tree, 0
+    printf("try_insert 16: %d\n", vEB_try_insert(tree, 16)); // -1 (VEB_ERANGE)
+    printf("try_insert -1: %d\n", vEB_try_insert(tree, -1)); // -1 (VEB_ERANGE)
+    int first = vEB_try_insert(tree, 7);
+    int again = vEB_try_insert(tree, 7);
+    printf("try_insert 7, again: %d, %d\n", first, again); // 1, 0
+
+    // 없는 키 삭제는 트리를 바꾸지 않음 (원소가 하나뿐일 때도)
+    printf("try_delete 3: %d\n", vEB_try_delete(tree, 3)); // 0
+    printf("Member 7: %d, Min: %d, Max: %d\n", vEB_member(tree, 7), tree->min, tree->max); // 1, 7, 7
+    vEB_insert(tree, 2);
+    vEB_insert(tree, 12);
+    printf("try_delete 13: %d\n", vEB_try_delete(tree, 13)); // 0
+    printf("try_delete 99: %d\n", vEB_try_delete(tree, 99)); // -1 (VEB_ERANGE)
+    first = vEB_delete(tree, 12);
+    again = vEB_delete(tree, 12);
+    printf("delete 12, again: %d, %d\n", first, again); // 1, 0
+    printf("Min: %d, Max: %d\n", tree->min, tree->max); // 2, 7
+    printf("Member -1: %d\n", vEB_member(tree, -1)); // 0
+    vEB_free(tree);
+
+    vEB64Node* t64 = vEB64_create(40);
+    vEB64_insert(t64, 5);
+    first = vEB64_delete(t64, 6);
+    again = vEB64_delete(t64, 5);
+    printf("vEB64 delete 6, 5: %d, %d\n", first, again); // 0, 1
+    vEB64_free(t64);
+
+    vEBCompact* c = vEBCompact_create(1 << 10);
+    vEBCompact_insert(c, 5);
+    first = vEBCompact_delete(c, 6);
+    again = vEBCompact_delete(c, 5);
+    printf("Compact delete 6, 5: %d, %d\n", first, again); // 0, 1
+    vEBCompact_free(c);
+}
+
+// 배치 삽입/삭제: 정렬된 입력은 같은 high(x)끼리 묶어 한 번에 처리
+void testcase_batch_ops() {
+    vEBNode* tree = vEB_create_ex(1 << 12, VEB_LAZY | VEB_FREE_EMPTY);
+    int sorted_keys[] = { 3, 5, 5, 64, 65, 66, 1000, 1001, 4095 };
+    printf("Insert batch (sorted): %d\n", vEB_insert_batch(tree, sorted_keys, 9)); // 8
+    int more[] = { 1, 3, 70, 4000 };
+    printf("Insert batch (new min): %d\n", vEB_insert_batch(tree, more, 4)); // 3
+    printf("Min: %d, Max: %d\n", tree->min, tree->max); // 1, 4095
+    printf("Successor of 5: %d\n", vEB_successor(tree, 5)); // 64
+    printf("Successor of 70: %d\n", vEB_successor(tree, 70)); // 1000
+
+    int unsorted[] = { 66, 2, 1000, 9 };
+    printf("Insert batch (unsorted): %d\n", vEB_insert_batch(tree, unsorted, 4)); // 2
+    int bad[] = { 7, 8, 4096 };
+    printf("Insert batch (out of range): %d\n", vEB_insert_batch(tree, bad, 3)); // -1 (VEB_ERANGE)
+    printf("Member 7: %d\n", vEB_member(tree, 7)); // 0
+
+    int gone[] = { 1, 2, 4, 64, 65, 66, 70, 4095 };
+    printf("Delete batch: %d\n", vEB_delete_batch(tree, gone, 8)); // 7
+    printf("Min: %d, Max: %d\n", tree->min, tree->max); // 3, 4000
+    printf("Successor of 5: %d\n", vEB_successor(tree, 5)); // 9
+    printf("Predecessor of 1000: %d\n", vEB_predecessor(tree, 1000)); // 9
+    vEB_free(tree);
+}
+
+// 정렬된 키 배열로 한 번에 트리 구성 (비어 있지 않은 클러스터만 할당)
+void testcase_build_sorted() {
+    int keys[] = { 0, 2, 2, 3, 100, 101, 4000, 65535 };
+    vEBNode* tree = vEB_build_sorted(1 << 16, keys, 8);
+    printf("Min: %d, Max: %d\n", tree->min, tree->max); // 0, 65535
+    printf("Member 2: %d, Member 99: %d\n", vEB_member(tree, 2), vEB_member(tree, 99)); // 1, 0
+    printf("Successor of 3: %d\n", vEB_successor(tree, 3)); // 100
+    printf("Successor of 4000: %d\n", vEB_successor(tree, 4000)); // 65535
+    printf("Predecessor of 4000: %d\n", vEB_predecessor(tree, 4000)); // 101
+    int allocated = 0;
+    for (int h = 0; h < tree->upper_sqrt; h++) allocated += tree->cluster[h] != NULL;
+    printf("Allocated clusters: %d\n", allocated); // 3
+    vEB_insert(tree, 5000);
+    vEB_delete(tree, 0);
+    printf("After insert 5000, delete 0: Min: %d, Successor of 4000: %d\n",
+           tree->min, vEB_successor(tree, 4000)); // 2, 5000
+    vEB_free(tree);
+
+    // 해시 클러스터와 비트맵 leaf도 같은 방식으로 구성
+    int dense[1000];
+    for (int i = 0; i < 1000; i++) dense[i] = 3 * i;
+    int err;
+    tree = vEB_build_sorted_ex(1 << 20, VEB_LAZY | VEB_HASHED | VEB_BITMAP_LEAVES, dense, 1000, &err);
+    printf("Built: %d, Member 2997: %d, Successor of 1500: %d\n",
+           err, vEB_member(tree, 2997), vEB_successor(tree, 1500)); // 0, 1, 1503
+    vEB_free(tree);
+
+    int unsorted[] = { 5, 3 };
+    tree = vEB_build_sorted_ex(16, VEB_LAZY, unsorted, 2, &err);
+    printf("Unsorted: %s, %d\n", tree ? "tree" : "NULL", err); // NULL, -2
+    int big[] = { 3, 16 };
+    tree = vEB_build_sorted_ex(16, VEB_LAZY, big, 2, &err);
+    printf("Out of range: %s, %d\n", tree ? "tree" : "NULL", err); // NULL, -1
+}
+
+// 범위 순회 콜백: 방문한 키를 출력하고, 5개를 넘으면 중단
+static int print_key_until_5(int key, void* ctx) {
+    int* seen = (int*)ctx;
+    printf(" %d", key);
+    return ++*seen >= 5;
+}
+
+// 범위 순회/개수: 클러스터를 다 비운 뒤에만 summary로 이동
+void testcase_range_iteration() {
+    vEBNode* tree = vEB_create_ex(1 << 12, VEB_LAZY | VEB_BITMAP_LEAVES);
+    int keys[] = { 1, 7, 63, 64, 65, 200, 1000, 1001, 4095 };
+    vEB_insert_batch(tree, keys, 9);
+
+    int seen = 0;
+    printf("Keys in [5, 1000]:");
+    int n = vEB_for_each_in_range(tree, 5, 1000, print_key_until_5, &seen);
+    printf("\nVisited: %d\n", n); // 7 63 64 65 200, 5
+    seen = 0;
+    printf("Keys in [900, 5000]:");
+    n = vEB_for_each_in_range(tree, 900, 5000, print_key_until_5, &seen);
+    printf("\nVisited: %d\n", n); // 1000 1001 4095, 3
+
+    printf("Count [0, 4095]: %d\n", vEB_count_range(tree, 0, 4095)); // 9
+    printf("Count [2, 64]: %d\n", vEB_count_range(tree, 2, 64)); // 3
+    printf("Count [66, 999]: %d\n", vEB_count_range(tree, 66, 999)); // 1
+    printf("Count [300, 200]: %d\n", vEB_count_range(tree, 300, 200)); // 0
+    vEB_free(tree);
+}
+
+// 배치 successor/predecessor: 단일 질의와 같은 결과
+void testcase_batch_queries() {
+    vEBNode* tree = vEB_create_ex(1 << 16, VEB_LAZY | VEB_BITMAP_LEAVES);
+    int keys[] = { 3, 64, 300, 301, 9000, 65535 };
+    vEB_insert_batch(tree, keys, 6);
+    int xs[] = { -5, 2, 3, 63, 301, 9000, 70000 };
+    int out[7];
+    vEB_successor_batch(tree, xs, out, 7);
+    printf("Successors:");
+    for (int i = 0; i < 7; i++) printf(" %d", out[i]);
+    printf("\n"); // 3 3 64 64 9000 65535 -1
+    vEB_predecessor_batch(tree, xs, out, 7);
+    printf("Predecessors:");
+    for (int i = 0; i < 7; i++) printf(" %d", out[i]);
+    printf("\n"); // -1 -1 -1 3 300 301 65535
+
+    // 청크(64개)보다 긴 배치
+    int many[200], succ[200];
+    int mismatches = 0;
+    for (int i = 0; i < 200; i++) many[i] = i * 317;
+    vEB_successor_batch(tree, many, succ, 200);
+    for (int i = 0; i < 200; i++) mismatches += succ[i] != vEB_successor(tree, many[i]);
+    printf("Mismatches: %d\n", mismatches); // 0
+    vEB_free(tree);
+}
+
+// 배치 멤버십: compact 트리는 SIMD gather 커널(AVX2/AVX-512, 없으면 스칼라)
+void testcase_member_batch() {
+    vEBCompact* c = vEBCompact_create(1 << 16);
+    vEBNode* tree = vEB_create_ex(1 << 16, VEB_LAZY | VEB_BITMAP_LEAVES);
+    for (int x = 0; x < (1 << 16); x += 1000) {
+        vEBCompact_insert(c, x);
+        vEB_insert(tree, x);
+    }
+    int xs[20];
+    unsigned char in_compact[20], in_tree[20];
+    for (int i = 0; i < 20; i++) xs[i] = (i % 2) ? i * 1000 : i * 1000 + 1;
+    xs[18] = -1000;  // 범위 밖 키는 0
+    xs[19] = 1 << 20;
+    vEBCompact_member_batch(c, xs, in_compact, 20);
+    vEB_member_batch(tree, xs, in_tree, 20);
+    printf("Compact:");
+    for (int i = 0; i < 20; i++) printf(" %d", in_compact[i]);
+    printf("\n"); // 0 1 0 1 0 1 0 1 0 1 0 1 0 1 0 1 0 1 0 0
+    printf("Tree:   ");
+    for (int i = 0; i < 20; i++) printf(" %d", in_tree[i]);
+    printf("\n"); // 0 1 0 1 0 1 0 1 0 1 0 1 0 1 0 1 0 1 0 0
+    vEBCompact_free(c);
+    vEB_free(tree);
+}
+
+// 동시 읽기 테스트용 리더 스레드: 짝수 키는 항상 존재해야 함
+static void* concurrent_reader(void* arg) {
+    vEBConcurrent* T = (vEBConcurrent*)arg;
+    long errors = 0;
+    for (int i = 0; i < 20000; i++) {
+        int k = (i * 37) % 1024 * 2;
+        if (!vEBConcurrent_member(T, k)) errors++;
+        if (vEBConcurrent_predecessor(T, k + 1) != k) errors++;
+    }
+    return (void*)errors;
+}
+
+// 락 없는 리더 + 직렬화된 writer (left-right)
+void testcase_concurrent_readers() {
+    vEBConcurrent* T = vEBConcurrent_create(1 << 11, VEB_LAZY | VEB_BITMAP_LEAVES);
+    for (int k = 0; k < (1 << 11); k += 2) vEBConcurrent_insert(T, k);
+
+    pthread_t readers[4];
+    for (int i = 0; i < 4; i++) pthread_create(&readers[i], NULL, concurrent_reader, T);
+    int changed = 0;
+    for (int i = 0; i < 5000; i++) {
+        int x = (i * 101) % 1024 * 2 + 1; // 홀수 키만 변경
+        changed += (i % 3) ? vEBConcurrent_insert(T, x) : vEBConcurrent_delete(T, x);
+    }
+    long errors = 0;
+    for (int i = 0; i < 4; i++) {
+        void* r;
+        pthread_join(readers[i], &r);
+        errors += (long)r;
+    }
+    printf("Reader errors: %ld\n", errors); // 0
+    printf("Writes that changed the set: %d\n", changed); // 3333
+    printf("Insert 0 again: %d, Successor of 2046: %d\n",
+           vEBConcurrent_insert(T, 0), vEBConcurrent_successor(T, 2046)); // 0, -1
+    vEBConcurrent_free(T);
+}
+
+// 원자적 비트맵 트리에 여러 스레드가 동시에 삽입 (스레드마다 나머지 클래스가 다름)
+typedef struct AtomicInsertJob {
+    vEBAtomic* A;
+    int residue;
+    int added;
+} AtomicInsertJob;
+
+static void* atomic_inserter(void* arg) {
+    AtomicInsertJob* job = (AtomicInsertJob*)arg;
+    for (int x = job->residue; x < (1 << 16); x += 4) {
+        if (x % 3 == 0) job->added += vEBAtomic_insert(job->A, x);
+    }
+    for (int x = job->residue; x < (1 << 16); x += 4) {
+        if (x % 6 == 0) vEBAtomic_delete(job->A, x);
+    }
+    return NULL;
+}
+
+// 락 없는 원자적 비트맵 트리 (U <= 2^26)
+void testcase_atomic_tree() {
+    vEBAtomic* A = vEBAtomic_create(1 << 16);
+    pthread_t th[4];
+    AtomicInsertJob jobs[4];
+    for (int i = 0; i < 4; i++) {
+        jobs[i].A = A;
+        jobs[i].residue = i;
+        jobs[i].added = 0;
+        pthread_create(&th[i], NULL, atomic_inserter, &jobs[i]);
+    }
+    int added = 0;
+    for (int i = 0; i < 4; i++) {
+        pthread_join(th[i], NULL);
+        added += jobs[i].added;
+    }
+    printf("Inserted: %d\n", added); // 21846
+    printf("Min: %d, Max: %d\n", vEBAtomic_min(A), vEBAtomic_max(A)); // 3, 65535
+    printf("Member 9: %d, Member 12: %d\n", vEBAtomic_member(A, 9), vEBAtomic_member(A, 12)); // 1, 0
+    printf("Successor of 3: %d\n", vEBAtomic_successor(A, 3)); // 9
+    printf("Predecessor of 9: %d\n", vEBAtomic_predecessor(A, 9)); // 3
+
+    // 한 워드 전체를 비우면 summary 비트도 정리됨
+    for (int x = 64; x < 4096; x++) vEBAtomic_delete(A, x);
+    printf("Successor of 63: %d\n", vEBAtomic_successor(A, 63)); // 4101
+    printf("Predecessor of 4101: %d\n", vEBAtomic_predecessor(A, 4101)); // 63
+    vEBAtomic_free(A);
+}
+
+// 상위 k비트로 나눈 샤드 트리: 배치는 샤드별로 나누어 스레드에서 병렬 처리
+void testcase_sharded_tree() {
+    vEBSharded* S = vEBSharded_create(1 << 16, 4, VEB_LAZY | VEB_BITMAP_LEAVES); // 16 shards x 4096
+    int keys[2000];
+    for (int i = 0; i < 2000; i++) keys[i] = i * 17;  // 0 .. 33983
+    printf("Insert batch (4 threads): %d\n", vEBSharded_insert_batch(S, keys, 2000, 4)); // 2000
+    printf("Insert batch again: %d\n", vEBSharded_insert_batch(S, keys, 2000, 4)); // 0
+    printf("Min: %d, Max: %d\n", vEBSharded_min(S), vEBSharded_max(S)); // 0, 33983
+
+    // 샤드 경계를 넘는 successor/predecessor는 summary를 사용
+    vEBSharded_insert(S, 60000);
+    printf("Successor of 33983: %d\n", vEBSharded_successor(S, 33983)); // 60000
+    printf("Predecessor of 60000: %d\n", vEBSharded_predecessor(S, 60000)); // 33983
+    printf("Successor of 4095: %d\n", vEBSharded_successor(S, 4095)); // 4097
+
+    int qs[4] = { -1, 100, 40000, 65535 };
+    int out[4];
+    vEBSharded_successor_batch(S, qs, out, 4, 2);
+    printf("Successors: %d %d %d %d\n", out[0], out[1], out[2], out[3]); // 0 102 60000 -1
+
+    int gone[1000];
+    for (int i = 0; i < 1000; i++) gone[i] = keys[1000 + i];
+    printf("Delete batch: %d\n", vEBSharded_delete_batch(S, gone, 1000, 3)); // 1000
+    printf("Successor of 16983: %d\n", vEBSharded_successor(S, 16983)); // 60000
+    int bad[] = { 1, 70000 };
+    printf("Out of range batch: %d\n", vEBSharded_insert_batch(S, bad, 2, 2)); // -1 (VEB_ERANGE)
+    vEBSharded_free(S);
+}
+
+// 스냅샷: 저장한 파일을 mmap으로 열어 역직렬화 없이 질의
+void testcase_snapshot() {
+    const char* path = "/tmp/vEB_snapshot_test.bin";
+    vEBNode* tree = vEB_create_ex(1 << 20, VEB_LAZY);
+    for (int i = 0; i < 1000; i++) vEB_insert(tree, i * 1000 + 7);
+    printf("Save: %d\n", vEB_save(tree, path)); // 0 (VEB_OK)
+
+    int err = -1;
+    vEBCompact* snap = vEBCompact_open_mmap(path, &err);
+    printf("Open: %d\n", err); // 0
+    printf("Min: %d, Max: %d\n", vEBCompact_min(snap), vEBCompact_max(snap)); // 7, 999007
+    printf("Member 5007? %d, Member 5008? %d\n",
+           vEBCompact_member(snap, 5007), vEBCompact_member(snap, 5008)); // 1, 0
+    printf("Successor of 5007: %d\n", vEBCompact_successor(snap, 5007)); // 6007
+    printf("Predecessor of 5007: %d\n", vEBCompact_predecessor(snap, 5007)); // 4007
+    // 읽기 전용 매핑은 수정할 수 없음 (오류 메시지 출력)
+    printf("Insert into snapshot: %d\n", vEBCompact_insert(snap, 1)); // 0
+    // 매핑을 연 채로 다시 저장해도 기존 매핑은 이전 이미지를 그대로 읽음
+    vEBNode* other = vEB_create_ex(1 << 20, VEB_LAZY);
+    vEB_insert(other, 42);
+    printf("Save over mapped: %d\n", vEB_save(other, path)); // 0
+    printf("Old mapping, member 5007? %d, successor of 5007: %d\n",
+           vEBCompact_member(snap, 5007), vEBCompact_successor(snap, 5007)); // 1, 6007
+    vEBCompact_free(snap);
+    snap = vEBCompact_open_mmap(path, &err);
+    printf("Reopen, min: %d, member 5007? %d\n", vEBCompact_min(snap), vEBCompact_member(snap, 5007)); // 42, 0
+    vEBCompact_free(snap);
+
+    // 임시 파일을 열 수 없으면 저장은 실패하고, 남아 있던 오래된 .tmp가 스냅샷을 덮어쓰지 않음
+    char tmp_path[64];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    vEB_save(tree, tmp_path); // 이전 충돌로 남은 .tmp를 흉내냄
+    struct rlimit old_limit, limit;
+    getrlimit(RLIMIT_NOFILE, &old_limit);
+    limit = old_limit;
+    limit.rlim_cur = 64;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    int fds[64], nfds = 0;
+    while (nfds < 64 && (fds[nfds] = open(path, O_RDONLY)) >= 0) nfds++; // 파일 디스크립터를 모두 소진
+    int rc = vEB_save(tree, path);
+    while (nfds > 0) close(fds[--nfds]);
+    setrlimit(RLIMIT_NOFILE, &old_limit);
+    snap = vEBCompact_open_mmap(path, &err);
+    printf("Save without descriptors: %d, min still %d, member 5007? %d\n", rc,
+           vEBCompact_min(snap), vEBCompact_member(snap, 5007)); // -4, 42, 0
+    vEBCompact_free(snap);
+    remove(tmp_path);
+    vEB_free(other);
+
+    // 스냅샷이 아닌 파일은 VEB_EFORMAT
+    FILE* f = fopen(path, "wb");
+    fputs("not a snapshot, just some text", f);
+    fclose(f);
+    vEBCompact* garbage = vEBCompact_open_mmap(path, &err);
+    printf("Open garbage: %s, %s\n", garbage ? "opened" : "NULL", vEB_strerror(err)); // NULL, not a valid snapshot
+    remove(path);
+    vEBCompact* missing = vEBCompact_open_mmap(path, &err);
+    printf("Open missing: %s, %s\n", missing ? "opened" : "NULL", vEB_strerror(err)); // NULL, snapshot I/O error
+    // 종료하지 않는 생성: 잘못된 U는 VEB_EINVAL
+    vEBCompact* bad = vEBCompact_try_create(12, &err);
+    printf("Try create U=12: %s, %d\n", bad ? "tree" : "NULL", err); // NULL, -2
+    vEB_free(tree);
+}
+
+// 델타 로그: 변경 사항은 로그에 추가되고, 다시 열 때 base 스냅샷 위에 재적용
+void testcase_delta_log() {
+    const char* path = "/tmp/vEB_store_test.bin";
+    remove(path);
+    remove("/tmp/vEB_store_test.bin.log");
+    int err;
+    vEBStore* S = vEBStore_open(path, 1 << 16, &err);
+    for (int i = 0; i < 100; i++) vEBStore_insert(S, i * 3);
+    printf("Insert again: %d\n", vEBStore_insert(S, 3)); // 0 (로그에 기록되지 않음)
+    printf("Delete 30: %d\n", vEBStore_delete(S, 30)); // 1
+    printf("Out of range: %d\n", vEBStore_insert(S, 1 << 16)); // -1 (VEB_ERANGE)
+    vEBStore_free(S);
+
+    // 다시 열면 base(빈 트리) + 로그 101개 레코드 재적용
+    S = vEBStore_open(path, 0, &err);
+    const vEBCompact* T = vEBStore_tree(S);
+    printf("Reopen: %d, Member 297? %d, Member 30? %d\n", err,
+           vEBCompact_member(T, 297), vEBCompact_member(T, 30)); // 0, 1, 0
+    printf("Successor of 27: %d\n", vEBCompact_successor(T, 27)); // 33
+
+    // 로그 쓰기가 실패하면 트리도 바뀌지 않음 (읽기 전용 fd로 흉내)
+    int log_fd = S->log_fd;
+    S->log_fd = open(path, O_RDONLY);
+    int r = vEBStore_insert(S, 1);
+    printf("Insert with failing log: %d, Member 1? %d\n", r, vEBCompact_member(vEBStore_tree(S), 1)); // -4, 0
+    close(S->log_fd);
+    S->log_fd = log_fd;
+    // 잘린 레코드를 지우지 못했으므로 다음 변경 전에 compaction으로 로그를 비움
+    r = vEBStore_insert(S, 1);
+    printf("Insert after log is back: %d, Log records: %d\n", r, (int)S->log_records); // 1, 1
+
+    // 자동 compaction이 실패해도 변경은 기록됨 (VEB_ECOMPACT)
+    char* tmp_path = S->tmp_path;
+    S->tmp_path = (char*)"/nonexistent-dir/vEB_store_test.tmp";
+    S->compact_at = S->log_records + 1;
+    r = vEBStore_insert(S, 2);
+    printf("Insert with failing compaction: %d, Member 2? %d\n", r, vEBCompact_member(vEBStore_tree(S), 2)); // -6, 1
+    S->tmp_path = tmp_path;
+    vEBStore_delete(S, 1);
+    vEBStore_delete(S, 2);
+    T = vEBStore_tree(S);
+
+    // compaction 후에는 로그가 비고 base에 모든 키가 들어 있음
+    printf("Compact: %d\n", vEBStore_compact(S)); // 0
+    vEBStore_delete(S, 0);
+    vEBStore_free(S);
+    S = vEBStore_open(path, 0, &err);
+    T = vEBStore_tree(S);
+    printf("After compact: Min %d, Max %d\n", vEBCompact_min(T), vEBCompact_max(T)); // 3, 297
+    vEBStore_free(S);
+    remove(path);
+    remove("/tmp/vEB_store_test.bin.log");
+}
+
+// 집합 연산: 합집합, 교집합, 차집합 (U가 같은 두 트리)
+void testcase_set_algebra() {
+    vEBNode* a = vEB_create_ex(1 << 12, VEB_LAZY | VEB_BITMAP_LEAVES);
+    vEBNode* b = vEB_create(1 << 12);
+    for (int i = 0; i < 4096; i += 2) vEB_insert(a, i);  // 짝수
+    for (int i = 0; i < 4096; i += 3) vEB_insert(b, i);  // 3의 배수
+
+    vEBNode* u = vEB_union(a, b);
+    vEBNode* in = vEB_intersect(a, b);
+    vEBNode* d = vEB_difference(a, b);
+    printf("Union: %d keys\n", vEB_count_range(u, 0, 4095)); // 2731
+    printf("Intersect: %d keys, Successor of 6: %d\n", vEB_count_range(in, 0, 4095), vEB_successor(in, 6)); // 683, 12
+    printf("Difference: %d keys, Member 6? %d, Member 8? %d\n",
+           vEB_count_range(d, 0, 4095), vEB_member(d, 6), vEB_member(d, 8)); // 1365, 0, 1
+
+    // 빈 트리와의 연산
+    vEBNode* e = vEB_create(1 << 12);
+    vEBNode* ie = vEB_intersect(a, e);
+    vEBNode* de = vEB_difference(a, e);
+    printf("Intersect with empty: Min %d\n", vEB_min(ie)); // -1
+    printf("Difference with empty: %d keys\n", vEB_count_range(de, 0, 4095)); // 2048
+
+    vEBNode* small = vEB_create(16);
+    printf("Mismatched U: %s\n", vEB_union(a, small) ? "tree" : "NULL"); // NULL (오류 메시지 출력)
+    vEB_free(a); vEB_free(b); vEB_free(u); vEB_free(in); vEB_free(d);
+    vEB_free(e); vEB_free(ie); vEB_free(de); vEB_free(small);
+}
+
+// 통계 카운터: -DVEB_STATS로 빌드했을 때만 수집됨
+void testcase_stats() {
+    vEBNode* tree = vEB_create_ex(1 << 16, VEB_LAZY | VEB_FREE_EMPTY | VEB_BITMAP_LEAVES);
+    vEBStats st;
+    int on = vEB_stats(tree, &st) == VEB_OK;
+    printf("Stats available: %s\n", on ? "yes" : "no"); // no (-DVEB_STATS이면 yes)
+    for (int i = 0; i < 1000; i++) vEB_insert(tree, i * 61);
+    vEB_stats_reset(tree);
+    printf("Successor of 0: %d\n", vEB_successor(tree, 0)); // 61
+    printf("Member 60939? %d\n", vEB_member(tree, 60939)); // 1
+#ifdef VEB_STATS
+    vEB_stats(tree, &st);
+    printf("Ops: %llu, Levels: %llu, Max depth: %llu\n", (unsigned long long)st.ops,
+           (unsigned long long)st.levels, (unsigned long long)st.max_depth); // 2, 3, 2
+    printf("Min/max hits: %llu, Summary falls: %llu\n", (unsigned long long)st.minmax_hits,
+           (unsigned long long)st.summary_falls); // 2, 0
+    for (int i = 0; i < 1000; i++) vEB_delete(tree, i * 61);
+    vEB_stats(tree, &st);
+    // VEB_FREE_EMPTY: 비게 된 cluster가 모두 해제되어 루트만 남음
+    printf("Live nodes after deleting all: %llu\n",
+           (unsigned long long)(st.nodes_allocated - st.nodes_freed)); // 1
+#endif
+    vEB_free(tree);
+}
+
+// 메모리 사용량: 실제 사용량과 생성 전 예측값
+void testcase_memory_usage() {
+    vEBNode* eager = vEB_create(1 << 12);
+    printf("Eager: usage == estimate? %d\n",
+           vEB_memory_usage(eager) == vEB_estimate_memory(1 << 12, 0, 0)); // 1
+    vEBNode* bitmap = vEB_create_ex(1 << 12, VEB_BITMAP_LEAVES);
+    printf("Bitmap leaves use less: %d\n", vEB_memory_usage(bitmap) < vEB_memory_usage(eager)); // 1
+
+    // lazy 트리는 키 수에 따라 커짐; 예측값은 무작위 키에 대한 기댓값
+    vEBNode* lazy = vEB_create_ex(1 << 20, VEB_LAZY | VEB_HASHED);
+    size_t empty = vEB_memory_usage(lazy);
+    srand(7);
+    for (int i = 0; i < 10000; i++) vEB_insert(lazy, rand() % (1 << 20));
+    int n = vEB_count_range(lazy, 0, (1 << 20) - 1);
+    double ratio = (double)vEB_memory_usage(lazy) / (double)vEB_estimate_memory(1 << 20, VEB_LAZY | VEB_HASHED, n);
+    printf("Lazy grows: %d, estimate within 10%%: %d\n", vEB_memory_usage(lazy) > empty,
+           ratio > 0.9 && ratio < 1.1); // 1, 1
+
+    vEBCompact* c = vEBCompact_create(1 << 16);
+    printf("Compact: usage == estimate? %d\n",
+           vEBCompact_memory_usage(c) == vEB_estimate_memory(1 << 16, VEB_COMPACT, 0)); // 1
+    printf("Invalid U: %llu\n", (unsigned long long)vEB_estimate_memory(1000, 0, 0)); // 0
+    vEB_free(eager); vEB_free(bitmap); vEB_free(lazy); vEBCompact_free(c);
+}
+
+// 키-값 맵: min/max와 leaf 슬롯에 값이 붙어 키와 함께 이동
+void testcase_kv_map() {
+    vEBMap* m = vEBMap_create(1 << 20);
+    static char a[] = "a", b[] = "b", c[] = "c", z[] = "z";
+    void* v = NULL;
+
+    printf("Empty: Successor of 5: %d\n", vEBMap_successor(m, 5, &v)); // -1
+    vEBMap_put(m, 10, a);
+    vEBMap_put(m, 70000, b);
+    vEBMap_put(m, 70001, c);
+    printf("Put existing key adds? %d\n", vEBMap_put(m, 70000, z)); // 0
+    printf("Get 70000: %s\n", vEBMap_get(m, 70000, &v) ? (char*)v : "-"); // z
+
+    // successor/predecessor는 키와 값을 한 번의 탐색으로 돌려줌
+    int k = vEBMap_successor(m, 10, &v);
+    printf("Successor of 10: %d -> %s\n", k, (char*)v); // 70000 -> z
+    k = vEBMap_predecessor(m, 70000, &v);
+    printf("Predecessor of 70000: %d -> %s\n", k, (char*)v); // 10 -> a
+    k = vEBMap_max(m, &v);
+    printf("Max: %d -> %s\n", k, (char*)v); // 70001 -> c
+
+    // min 삭제 후 다음 키가 값과 함께 min으로 올라옴
+    int r = vEBMap_delete(m, 10, &v);
+    printf("Delete 10: %d, value %s\n", r, (char*)v); // 1, a
+    k = vEBMap_min(m, &v);
+    printf("New min: %d -> %s\n", k, (char*)v); // 70000 -> z
+    printf("Delete 10 again: %d\n", vEBMap_delete(m, 10, NULL)); // 0
+    vEBMap_free(m);
+}
+
+// 우선순위 큐: extract_min/extract_max/decrease_key로 타이머 스케줄링
+void testcase_priority_queue() {
+    vEBNode* q = vEB_create_ex(1 << 16, VEB_LAZY | VEB_FREE_EMPTY | VEB_BITMAP_LEAVES);
+    printf("Empty: extract_min: %d\n", vEB_extract_min(q)); // -1
+
+    int deadlines[] = {500, 20, 40000, 7, 1234};
+    for (int i = 0; i < 5; i++) vEB_insert(q, deadlines[i]);
+    int a = vEB_extract_min(q);
+    int b = vEB_extract_min(q);
+    printf("extract_min twice: %d %d\n", a, b); // 7 20
+    printf("extract_max: %d\n", vEB_extract_max(q)); // 40000
+
+    // 타이머를 앞당김: 1234 -> 100, 이미 있는 키로 옮기면 합쳐짐
+    printf("decrease_key 1234 -> 100: %d\n", vEB_decrease_key(q, 1234, 100)); // 1
+    printf("decrease_key 9 -> 3 (absent): %d\n", vEB_decrease_key(q, 9, 3)); // 0
+    printf("decrease_key 500 -> 100 (merge): %d\n", vEB_decrease_key(q, 500, 100)); // 1
+    a = vEB_extract_min(q);
+    b = vEB_extract_min(q);
+    printf("Drain: %d %d\n", a, b); // 100 -1
+    vEB_free(q);
+
+    // 무작위 extract / decrease_key를 배열과 비교 (생성 플래그별)
+    unsigned flag_sets[] = { 0, VEB_LAZY | VEB_FREE_EMPTY | VEB_BITMAP_LEAVES, VEB_LAZY | VEB_HASHED,
+                             VEB_ARENA, VEB_COUNTED };
+    int U = 1 << 10, errors = 0;
+    unsigned seed = 12345;
+    for (int f = 0; f < 5; f++) {
+        vEBNode* t = vEB_create_ex(U, flag_sets[f]);
+        char present[1 << 10] = {0};
+        for (int i = 0; i < 20000; i++) {
+            seed = seed * 1103515245 + 12345;
+            int x = (int)((seed >> 8) % (unsigned)U), op = (int)((seed >> 4) % 5);
+            int lo = 0, hi = U - 1;
+            while (lo < U && !present[lo]) lo++;
+            while (hi >= 0 && !present[hi]) hi--;
+            if (op <= 1) {
+                if (vEB_insert(t, x) != !present[x]) errors++;
+                present[x] = 1;
+            }
+            else if (op == 2) {
+                if (vEB_extract_min(t) != (lo < U ? lo : -1)) errors++;
+                if (lo < U) present[lo] = 0;
+            }
+            else if (op == 3) {
+                if (vEB_extract_max(t) != hi) errors++;
+                if (hi >= 0) present[hi] = 0;
+            }
+            else {
+                int y = (int)((seed >> 20) % (unsigned)(x + 1));
+                if (vEB_decrease_key(t, x, y) != present[x]) errors++;
+                if (present[x]) {
+                    present[x] = 0;
+                    present[y] = 1;
+                }
+            }
+        }
+        vEB_free(t);
+    }
+    printf("Random extract/decrease mismatches: %d\n", errors); // 0
+}
+
+// 순위/선택: cluster별 키 수로 rank와 select 계산 (VEB_COUNTED)
+void testcase_rank_select() {
+    vEBNode* t = vEB_create_ex(1 << 20, VEB_LAZY | VEB_FREE_EMPTY | VEB_BITMAP_LEAVES | VEB_COUNTED);
+    for (int i = 0; i < 1000; i++) vEB_insert(t, i * 1000);
+    printf("Size: %d\n", vEB_size(t)); // 1000
+    printf("Rank of 500000 (keys < x): %d\n", vEB_rank(t, 500000)); // 500
+    printf("Rank of 500001: %d\n", vEB_rank(t, 500001)); // 501
+    printf("Select 0, 500, 999: %d %d %d\n", vEB_select(t, 0), vEB_select(t, 500), vEB_select(t, 999)); // 0 500000 999000
+    printf("Select 1000: %d\n", vEB_select(t, 1000)); // -1
+
+    // 삭제 후에도 카운트가 유지됨
+    vEB_delete(t, 0);
+    vEB_extract_max(t);
+    printf("After deletes: size %d, select 0 = %d\n", vEB_size(t), vEB_select(t, 0)); // 998, 1000
+    printf("Count [1000, 9999]: %d\n", vEB_count_range(t, 1000, 9999)); // 9
+
+    // 카운트 없는 트리는 같은 결과를 순회로 계산
+    vEBNode* plain = vEB_create_ex(1 << 10, VEB_LAZY);
+    vEB_insert(plain, 3); vEB_insert(plain, 700);
+    printf("Plain tree: size %d, rank(700) %d, select(1) %d\n",
+           vEB_size(plain), vEB_rank(plain, 700), vEB_select(plain, 1)); // 2, 1, 700
+    vEB_free(t);
+    vEB_free(plain);
+}
+
+// 압축 스윕: 빈 cluster를 budget만큼씩 나눠서 해제
+void testcase_compact_sweep() {
+    // VEB_FREE_EMPTY 없는 lazy 트리: 삭제 후에도 빈 cluster가 남아 있음
+    vEBNode* t = vEB_create_ex(1 << 16, VEB_LAZY);
+    for (int i = 0; i < 4096; i++) vEB_insert(t, i * 16);
+    size_t full = vEB_memory_usage(t);
+    for (int i = 1; i < 4096; i++) vEB_delete(t, i * 16);
+    printf("Deletes freed nothing: %d\n", vEB_memory_usage(t) == full); // 1
+
+    // 작은 budget으로 여러 번 호출해 한 바퀴를 끝냄
+    vEBSweep sweep = {{0}, 0};
+    int calls = 1;
+    while (vEB_compact(t, &sweep, 64) == 0) calls++;
+    printf("Needed several calls: %d\n", calls > 1); // 1
+    printf("Released nodes: %d, memory shrank: %d\n", sweep.released > 0,
+           vEB_memory_usage(t) < full / 10); // 1, 1
+    printf("Key 0 still present: %d, Successor of 0: %d\n", vEB_member(t, 0), vEB_successor(t, 0)); // 1, -1
+
+    vEB_insert(t, 777);
+    printf("Insert after sweep, Successor of 0: %d\n", vEB_successor(t, 0)); // 777
+    printf("Invalid budget: %d\n", vEB_compact(t, &sweep, 0)); // -2
+    vEB_free(t);
+}
+
+// NUMA 복제본 테스트용 리더 스레드: 짝수 키는 항상 존재해야 함
+static void* replica_reader(void* arg) {
+    vEBReplicated* R = (vEBReplicated*)arg;
+    long errors = 0;
+    for (int i = 0; i < 20000; i++) {
+        int k = (i * 37) % 1024 * 2;
+        if (!vEBReplicated_member(R, k)) errors++;
+        if (vEBReplicated_predecessor(R, k + 1) != k) errors++;
+    }
+    return (void*)errors;
+}
+
+// NUMA 노드별 복제본: writer 하나가 모든 복제본에 같은 순서로 적용
+void testcase_numa_replicas() {
+    printf("NUMA nodes >= 1: %d\n", vEB_numa_nodes() >= 1); // 1
+    vEBReplicated* d = vEBReplicated_create(1 << 8, 0, 0);
+    printf("Default replicas == nodes: %d\n", d->replicas == vEB_numa_nodes()); // 1
+    vEBReplicated_free(d);
+
+    // 노드 수와 관계없이 복제본 3개 (eager arena 트리는 생성 스레드의 노드에 배치됨)
+    vEBReplicated* R = vEBReplicated_create(1 << 11, VEB_ARENA | VEB_BITMAP_LEAVES, 3);
+    int local = vEB_numa_node();
+    printf("Replicas: %d, local replica is on this node: %d\n", R->replicas,
+           R->node[R->by_node[local]] == local); // 3, 1
+    for (int k = 0; k < (1 << 11); k += 2) vEBReplicated_insert(R, k);
+
+    pthread_t readers[2];
+    for (int i = 0; i < 2; i++) pthread_create(&readers[i], NULL, replica_reader, R);
+    int changed = 0;
+    for (int i = 0; i < 5000; i++) {
+        int x = (i * 101) % 1024 * 2 + 1; // 홀수 키만 변경
+        changed += (i % 3) ? vEBReplicated_insert(R, x) : vEBReplicated_delete(R, x);
+    }
+    long errors = 0;
+    for (int i = 0; i < 2; i++) {
+        void* r;
+        pthread_join(readers[i], &r);
+        errors += (long)r;
+    }
+    printf("Reader errors: %ld\n", errors); // 0
+    printf("Writes that changed the set: %d\n", changed); // 3333
+
+    int agree = 1;
+    for (int i = 1; i < R->replicas; i++) {
+        for (int x = 0; x < (1 << 11); x++) {
+            if (vEBConcurrent_member(R->rep[i], x) != vEBConcurrent_member(R->rep[0], x)) agree = 0;
+        }
+    }
+    printf("All replicas agree: %d\n", agree); // 1
+    printf("Insert 0 again: %d, Successor of 2046: %d\n",
+           vEBReplicated_insert(R, 0), vEBReplicated_successor(R, 2046)); // 0, -1
+    vEBReplicated_free(R);
+}
+
 int main() {
     printf("\n======== testcase empty tree ========\n\n");
     testcase_empty_tree();
@@ -580,6 +5789,63 @@ int main() {
     testcase_min_max_boundary();
     printf("\n======== testcase insert delete sequence state ========\n\n");
     testcase_insert_delete_sequence_state();
+    printf("\n======== testcase lazy tree ========\n\n");
+    testcase_lazy_tree();
+    printf("\n======== testcase lazy free empty ========\n\n");
+    testcase_lazy_free_empty();
+    printf("\n======== testcase bitmap leaves ========\n\n");
+    testcase_bitmap_leaves();
+    printf("\n======== testcase shift mask geometry ========\n\n");
+    testcase_shift_mask_geometry();
+    printf("\n======== testcase veb64 ========\n\n");
+    testcase_veb64();
+    printf("\n======== testcase hashed clusters ========\n\n");
+    testcase_hashed_clusters();
+    printf("\n======== testcase arena tree ========\n\n");
+    testcase_arena_tree();
+    printf("\n======== testcase compact tree ========\n\n");
+    testcase_compact_tree();
+    printf("\n======== testcase insert reports new ========\n\n");
+    testcase_insert_reports_new();
+    printf("\n======== testcase error codes ========\n\n");
+    testcase_error_codes();
+    printf("\n======== testcase batch ops ========\n\n");
+    testcase_batch_ops();
+    printf("\n======== testcase build sorted ========\n\n");
+    testcase_build_sorted();
+    printf("\n======== testcase range iteration ========\n\n");
+    testcase_range_iteration();
+    printf("\n======== testcase batch queries ========\n\n");
+    testcase_batch_queries();
+    printf("\n======== testcase member batch ========\n\n");
+    testcase_member_batch();
+    printf("\n======== testcase concurrent readers ========\n\n");
+    testcase_concurrent_readers();
+    printf("\n======== testcase atomic tree ========\n\n");
+    testcase_atomic_tree();
+    printf("\n======== testcase sharded tree ========\n\n");
+    testcase_sharded_tree();
+    printf("\n======== testcase snapshot ========\n\n");
+    testcase_snapshot();
+    printf("\n======== testcase delta log ========\n\n");
+    testcase_delta_log();
+    printf("\n======== testcase set algebra ========\n\n");
+    testcase_set_algebra();
+    printf("\n======== testcase stats ========\n\n");
+    testcase_stats();
+    printf("\n======== testcase memory usage ========\n\n");
+    testcase_memory_usage();
+    printf("\n======== testcase key-value map ========\n\n");
+    testcase_kv_map();
+    printf("\n======== testcase priority queue ========\n\n");
+    testcase_priority_queue();
+    printf("\n======== testcase rank and select ========\n\n");
+    testcase_rank_select();
+    printf("\n======== testcase compaction sweep ========\n\n");
+    testcase_compact_sweep();
+    printf("\n======== testcase numa replicas ========\n\n");
+    testcase_numa_replicas();
 
     return 0;
 }
+#endif // VEB_NO_MAIN
@@ -0,0 +1,389 @@
+// van Emde Boas tree with compile-time geometry (header-only, C++17)
+//
+//   veb::veb_tree<20> t;          // universe [0, 2^20)
+//   t.insert(42);
+//   std::optional<uint32_t> s = t.successor(7);
+//
+// The same structure as vEBNode in vEBTree.c with VEB_LAZY |
+// VEB_FREE_EMPTY | VEB_BITMAP_LEAVES: each node keeps min (not stored in a
+// cluster) and max, clusters are allocated on first insert and released
+// when they become empty, and subtrees of up to 64 keys are one bitmap
+// word. The universe is a template parameter, so the high/low split of
+// every level, the leaf cutoff and the recursion itself are resolved at
+// compile time: each level is its own type, its summary is stored inline,
+// and the calls of one operation inline into a fixed sequence of shifts
+// and masks with no u <= 2 checks and no geometry loads.
+//
+// veb::priority_queue<Bits, Compare> puts the std::priority_queue
+// interface on top of it, for integer priorities such as timer deadlines.
+#ifndef VEBTREE_HPP
+#define VEBTREE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <unordered_map>
+
+namespace veb {
+
+constexpr unsigned leaf_bits = 6;   // log2 of the bitmap leaf size
+constexpr unsigned max_bits = 32;   // key_type is uint32_t
+
+template <unsigned Bits, bool Leaf = (Bits <= leaf_bits)>
+class node;
+
+template <unsigned Bits>
+using veb_tree = node<Bits>;
+
+// Bitmap leaf: bit i set <=> key i present
+template <unsigned Bits>
+class node<Bits, true> {
+public:
+    using key_type = uint32_t;
+    static constexpr uint64_t universe = 1ULL << Bits;
+
+    bool empty() const { return bits_ == 0; }
+    bool contains(key_type x) const { return x < universe && ((bits_ >> x) & 1); }
+    std::optional<key_type> min() const { return empty() ? std::nullopt : std::optional<key_type>(min_key()); }
+    std::optional<key_type> max() const { return empty() ? std::nullopt : std::optional<key_type>(max_key()); }
+
+    // true if x was added (false if present or out of range)
+    bool insert(key_type x) {
+        if (x >= universe || contains(x)) return false;
+        bits_ |= 1ULL << x;
+        return true;
+    }
+
+    // true if x was removed
+    bool erase(key_type x) {
+        if (!contains(x)) return false;
+        bits_ &= ~(1ULL << x);
+        return true;
+    }
+
+    // smallest key > x
+    std::optional<key_type> successor(key_type x) const {
+        if (x >= universe - 1) return std::nullopt;
+        uint64_t word = bits_ & (~0ULL << (x + 1));
+        if (!word) return std::nullopt;
+        return (key_type)__builtin_ctzll(word);
+    }
+
+    // largest key < x
+    std::optional<key_type> predecessor(key_type x) const {
+        if (x == 0) return std::nullopt;
+        uint64_t word = x >= universe ? bits_ : bits_ & (~0ULL >> (64 - x));
+        if (!word) return std::nullopt;
+        return (key_type)(63 - __builtin_clzll(word));
+    }
+
+    // remove and return the smallest / largest key
+    std::optional<key_type> extract_min() { return empty() ? std::nullopt : std::optional<key_type>(pop_min()); }
+    std::optional<key_type> extract_max() { return empty() ? std::nullopt : std::optional<key_type>(pop_max()); }
+
+    // replace present key x by y <= x (merging if y is present); false if
+    // x is absent or y > x
+    bool decrease_key(key_type x, key_type y) {
+        if (y > x || !contains(x)) return false;
+        move_down(x, y);
+        return true;
+    }
+
+private:
+    template <unsigned, bool> friend class node;
+
+    key_type min_key() const { return (key_type)__builtin_ctzll(bits_); }
+    key_type max_key() const { return (key_type)(63 - __builtin_clzll(bits_)); }
+    void insert_empty(key_type x) { bits_ = 1ULL << x; }
+    key_type pop_min() { key_type x = min_key(); bits_ &= bits_ - 1; return x; }
+    key_type pop_max() { key_type x = max_key(); bits_ &= ~(1ULL << x); return x; }
+    void move_down(key_type x, key_type y) { bits_ = (bits_ & ~(1ULL << x)) | (1ULL << y); }
+
+    uint64_t bits_ = 0;
+};
+
+// Internal level: 2^hi_bits clusters of 2^lo_bits keys each
+template <unsigned Bits>
+class node<Bits, false> {
+    static_assert(Bits <= max_bits, "veb_tree supports universes up to 2^32");
+
+public:
+    using key_type = uint32_t;
+    static constexpr uint64_t universe = 1ULL << Bits;
+    static constexpr unsigned lo_bits = Bits / 2;
+    static constexpr unsigned hi_bits = Bits - lo_bits;
+    static constexpr uint64_t clusters = 1ULL << hi_bits;
+
+    node() = default;
+    node(node&&) = default;
+    node& operator=(node&&) = default;
+
+    bool empty() const { return min_ > max_; }
+    std::optional<key_type> min() const { return empty() ? std::nullopt : std::optional<key_type>(min_); }
+    std::optional<key_type> max() const { return empty() ? std::nullopt : std::optional<key_type>(max_); }
+
+    bool contains(key_type x) const {
+        if (empty() || x < min_ || x > max_) return false;
+        if (x == min_ || x == max_) return true;
+        const cluster_type* C = cluster(high(x));
+        return C && C->contains(low(x));
+    }
+
+    // true if x was added (false if present or out of range)
+    bool insert(key_type x) {
+        if (x >= universe) return false;
+        if (empty()) {
+            min_ = max_ = x;
+            return true;
+        }
+        if (x == min_ || x == max_) return false;
+        if (x < min_) {
+            key_type tmp = x; x = min_; min_ = tmp;
+        }
+        key_type h = high(x), l = low(x);
+        if (!cluster_) cluster_.reset(new std::unique_ptr<cluster_type>[clusters]);
+        std::unique_ptr<cluster_type>& C = cluster_[h];
+        if (!C) {
+            C.reset(new cluster_type());
+            summary_.insert(h);
+            C->insert_empty(l);
+        }
+        else if (!C->insert(l)) {
+            return false;  // only reachable without a swap above
+        }
+        if (x > max_) max_ = x;
+        return true;
+    }
+
+    // true if x was removed
+    bool erase(key_type x) {
+        if (empty() || x < min_ || x > max_) return false;
+        if (min_ == max_) {
+            if (x != min_) return false;
+            min_ = (key_type)(universe - 1);
+            max_ = 0;
+            return true;
+        }
+        if (x == min_) {
+            // promote the smallest key out of the clusters
+            key_type first = summary_.min_key();
+            x = idx(first, cluster_[first]->min_key());
+            min_ = x;
+        }
+        key_type h = high(x), l = low(x);
+        cluster_type* C = cluster(h);
+        if (!C || !C->erase(l)) return false;
+        if (C->empty()) {
+            cluster_[h].reset();
+            summary_.erase(h);
+            if (summary_.empty()) release_clusters();
+            if (x == max_) {
+                max_ = summary_.empty() ? min_ : idx(summary_.max_key(), cluster_[summary_.max_key()]->max_key());
+            }
+        }
+        else if (x == max_) {
+            max_ = idx(h, C->max_key());
+        }
+        return true;
+    }
+
+    // smallest key > x
+    std::optional<key_type> successor(key_type x) const {
+        if (empty() || x >= max_) return std::nullopt;
+        if (x < min_) return min_;
+        key_type h = high(x), l = low(x);
+        const cluster_type* C = cluster(h);
+        if (C && l < C->max_key()) return idx(h, *C->successor(l));
+        key_type next = *summary_.successor(h);  // exists: x < max_
+        return idx(next, cluster_[next]->min_key());
+    }
+
+    // largest key < x
+    std::optional<key_type> predecessor(key_type x) const {
+        if (empty() || x <= min_) return std::nullopt;
+        if (x > max_) return max_;
+        key_type h = high(x), l = low(x);
+        const cluster_type* C = cluster(h);
+        if (C && l > C->min_key()) return idx(h, *C->predecessor(l));
+        std::optional<key_type> prev = summary_.predecessor(h);
+        if (!prev) return min_;
+        return idx(*prev, cluster_[*prev]->max_key());
+    }
+
+    // remove and return the smallest / largest key
+    std::optional<key_type> extract_min() { return empty() ? std::nullopt : std::optional<key_type>(pop_min()); }
+    std::optional<key_type> extract_max() { return empty() ? std::nullopt : std::optional<key_type>(pop_max()); }
+
+    // replace present key x by y <= x (merging if y is present); false if
+    // x is absent or y > x
+    bool decrease_key(key_type x, key_type y) {
+        if (y > x || !contains(x)) return false;
+        if (x != y) move_down(x, y);
+        return true;
+    }
+
+private:
+    template <unsigned, bool> friend class node;
+    using cluster_type = node<lo_bits>;
+    using summary_type = node<hi_bits>;
+
+    static constexpr key_type high(key_type x) { return x >> lo_bits; }
+    static constexpr key_type low(key_type x) { return x & (key_type)((1ULL << lo_bits) - 1); }
+    static constexpr key_type idx(key_type h, key_type l) { return (h << lo_bits) | l; }
+
+    key_type min_key() const { return min_; }
+    key_type max_key() const { return max_; }
+    void insert_empty(key_type x) { min_ = max_ = x; }
+
+    // delete of the min/max without a search (the node is not empty): the
+    // key to remove is the min/max of the summary's first/last cluster
+    key_type pop_min() {
+        key_type x = min_;
+        if (min_ == max_) {
+            min_ = (key_type)(universe - 1);
+            max_ = 0;
+            return x;
+        }
+        key_type first = summary_.min_key();
+        cluster_type* C = cluster_[first].get();
+        min_ = idx(first, C->pop_min());
+        if (C->empty()) {
+            // if C held the max, it is now min_ as well
+            cluster_[first].reset();
+            summary_.pop_min();
+            if (summary_.empty()) release_clusters();
+        }
+        return x;
+    }
+
+    key_type pop_max() {
+        key_type x = max_;
+        if (min_ == max_) {
+            min_ = (key_type)(universe - 1);
+            max_ = 0;
+            return x;
+        }
+        key_type last = summary_.max_key();
+        cluster_type* C = cluster_[last].get();
+        C->pop_max();
+        if (C->empty()) {
+            cluster_[last].reset();
+            summary_.pop_max();
+            if (summary_.empty()) release_clusters();
+            max_ = summary_.empty() ? min_ : idx(summary_.max_key(), cluster_[summary_.max_key()]->max_key());
+        }
+        else {
+            max_ = idx(last, C->max_key());
+        }
+        return x;
+    }
+
+    // x present, y < x: y replaces a min in place, and a move inside one
+    // cluster leaves the summary alone
+    void move_down(key_type x, key_type y) {
+        if (x == min_) {
+            if (x == max_) max_ = y;
+            min_ = y;
+            return;
+        }
+        key_type h = high(x);
+        if (y > min_ && h == high(y)) {
+            cluster_type* C = cluster_[h].get();
+            C->move_down(low(x), low(y));
+            if (x == max_) max_ = idx(h, C->max_key());
+            return;
+        }
+        erase(x);
+        insert(y);
+    }
+
+    // back to a single key: the cluster array goes as well
+    void release_clusters() { cluster_.reset(); }
+
+    const cluster_type* cluster(key_type h) const { return cluster_ ? cluster_[h].get() : nullptr; }
+    cluster_type* cluster(key_type h) { return cluster_ ? cluster_[h].get() : nullptr; }
+
+    // empty <=> min_ > max_
+    key_type min_ = (key_type)(universe - 1);
+    key_type max_ = 0;
+    summary_type summary_;
+    std::unique_ptr<std::unique_ptr<cluster_type>[]> cluster_;
+};
+
+// std::priority_queue interface over veb_tree<Bits>: top() is the key that
+// comes last under Compare, so std::less (the default) pops the largest
+// key and std::greater the smallest. Equal keys are allowed; copies beyond
+// the first are counted on the side and cost a hash lookup.
+template <unsigned Bits, class Compare = std::less<uint32_t>>
+class priority_queue {
+    static_assert(std::is_same<Compare, std::less<uint32_t>>::value ||
+                  std::is_same<Compare, std::greater<uint32_t>>::value,
+                  "priority_queue supports std::less<uint32_t> and std::greater<uint32_t>");
+    static constexpr bool min_first = std::is_same<Compare, std::greater<uint32_t>>::value;
+
+public:
+    using value_type = uint32_t;
+    using size_type = std::size_t;
+    using value_compare = Compare;
+
+    bool empty() const { return size_ == 0; }
+    size_type size() const { return size_; }
+
+    // precondition: !empty()
+    value_type top() const { return min_first ? *tree_.min() : *tree_.max(); }
+
+    // keys must be < 2^Bits
+    void push(value_type x) {
+        add(x);
+        ++size_;
+    }
+
+    // precondition: !empty()
+    void pop() {
+        value_type x = top();
+        if (!drop_extra(x)) {
+            if (min_first) tree_.extract_min();
+            else tree_.extract_max();
+        }
+        --size_;
+    }
+
+    // replace one copy of x by y <= x, as when a timer is moved earlier;
+    // false if x is not queued or y > x
+    bool decrease_key(value_type x, value_type y) {
+        if (y > x || !tree_.contains(x)) return false;
+        if (x == y) return true;
+        if (drop_extra(x)) add(y);
+        else if (tree_.contains(y)) {
+            tree_.erase(x);
+            ++extra_[y];
+        }
+        else tree_.decrease_key(x, y);
+        return true;
+    }
+
+private:
+    // one copy of x beyond the one in the tree removed, if there was one
+    bool drop_extra(value_type x) {
+        if (extra_.empty()) return false;
+        auto it = extra_.find(x);
+        if (it == extra_.end()) return false;
+        if (--it->second == 0) extra_.erase(it);
+        return true;
+    }
+
+    void add(value_type x) {
+        if (!tree_.insert(x)) ++extra_[x];
+    }
+
+    veb_tree<Bits> tree_;
+    std::unordered_map<value_type, size_type> extra_;
+    size_type size_ = 0;
+};
+
+} // namespace veb
+
+#endif // VEBTREE_HPP
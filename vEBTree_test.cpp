@@ -0,0 +1,260 @@
+// Tests for vEBTree.hpp
+//
+//   g++ -std=c++17 -O2 -o vEBTree_test vEBTree_test.cpp && ./vEBTree_test
+//
+// Like the main() of vEBTree.c, every testcase prints its results with the
+// expected value in a comment. The randomized runs repeat each operation
+// on a std::set and print how many results differed.
+#include "vEBTree.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <random>
+#include <set>
+
+// Heap blocks currently allocated, to see cluster arrays being released
+static long live_blocks = 0;
+
+void* operator new(std::size_t n) {
+    void* p = std::malloc(n ? n : 1);
+    if (!p) throw std::bad_alloc();
+    ++live_blocks;
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    --live_blocks;
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+
+// Random inserts, erases and lookups on t and on a std::set; every step
+// also compares successor, predecessor, min and max. Keys come from the
+// whole universe or a small window, so clusters fill up and empty often.
+template <unsigned Bits>
+static long compare_with_set(veb::veb_tree<Bits>& t, std::set<uint32_t>& ref, std::mt19937_64& rng, int ops) {
+    const uint64_t U = 1ULL << Bits;
+    const uint64_t window = U < 4096 ? U : 4096;
+    long bad = 0;
+    for (int i = 0; i < ops; i++) {
+        uint32_t x = (uint32_t)((rng() & 1) ? rng() % U : rng() % window);
+        switch (rng() % 4) {
+        case 0:
+        case 1: bad += t.insert(x) != ref.insert(x).second; break;
+        case 2: bad += t.erase(x) != (ref.erase(x) == 1); break;
+        default: bad += t.contains(x) != (ref.count(x) == 1); break;
+        }
+        std::optional<uint32_t> s = t.successor(x);
+        std::set<uint32_t>::iterator next = ref.upper_bound(x);
+        bad += (next == ref.end()) ? s.has_value() : (!s || *s != *next);
+        std::optional<uint32_t> p = t.predecessor(x);
+        std::set<uint32_t>::iterator lo = ref.lower_bound(x);
+        bad += (lo == ref.begin()) ? p.has_value() : (!p || *p != *std::prev(lo));
+        if (ref.empty()) bad += t.min().has_value() || t.max().has_value() || !t.empty();
+        else bad += !t.min() || *t.min() != *ref.begin() || !t.max() || *t.max() != *ref.rbegin();
+    }
+    return bad;
+}
+
+template <unsigned Bits>
+static void run_against_set(unsigned long long seed) {
+    long before = live_blocks;
+    veb::veb_tree<Bits> t;
+    std::set<uint32_t> ref;
+    std::mt19937_64 rng(seed);
+    long bad = compare_with_set(t, ref, rng, 20000);
+    // 전부 지운 뒤에는 비어 있고, cluster가 하나도 남지 않아야 함
+    while (!ref.empty()) {
+        uint32_t x = *ref.begin();
+        ref.erase(ref.begin());
+        bad += !t.erase(x);
+    }
+    bad += !t.empty() || t.min().has_value();
+    printf("Bits %u: mismatches %ld, heap blocks left %ld\n", Bits, bad, live_blocks - before);
+}
+
+// veb_tree<Bits>를 std::set과 비교 (leaf 하나, 여러 단계, 32비트 전체)
+void testcase_template_vs_set() {
+    run_against_set<5>(1);   // 0, 0
+    run_against_set<8>(2);   // 0, 0
+    run_against_set<13>(3);  // 0, 0
+    run_against_set<20>(4);  // 0, 0
+    run_against_set<32>(5);  // 0, 0
+}
+
+// key가 하나만 남으면 cluster 배열까지 해제되어야 함
+void testcase_template_release() {
+    long before = live_blocks;
+    veb::veb_tree<20> t;
+    for (uint32_t x = 0; x < 5000; x += 7) t.insert(x);
+    printf("Clusters allocated: %d\n", live_blocks > before); // 1
+    for (uint32_t x = 7; x < 5000; x += 7) t.erase(x);
+    printf("Heap blocks with one key left: %ld\n", live_blocks - before); // 0
+    printf("Min: %u, Max: %u\n", *t.min(), *t.max()); // 0, 0
+    t.insert(1 << 19);
+    printf("Successor of 0: %u\n", *t.successor(0)); // 524288
+    t.erase(0);
+    printf("Heap blocks after erasing the min: %ld\n", live_blocks - before); // 0
+    printf("Min: %u, Contains 0? %d\n", *t.min(), t.contains(0)); // 524288, 0
+}
+
+// extract_min / extract_max / decrease_key of veb_tree<Bits> against std::set
+template <unsigned Bits>
+static void run_extract_against_set(unsigned long long seed) {
+    const uint64_t U = 1ULL << Bits;
+    long before = live_blocks;
+    veb::veb_tree<Bits> t;
+    std::set<uint32_t> ref;
+    std::mt19937_64 rng(seed);
+    long bad = 0;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t x = (uint32_t)(rng() % U);
+        switch (rng() % 5) {
+        case 0:
+        case 1: bad += t.insert(x) != ref.insert(x).second; break;
+        case 2: {
+            std::optional<uint32_t> m = t.extract_min();
+            if (ref.empty()) bad += m.has_value();
+            else {
+                bad += !m || *m != *ref.begin();
+                ref.erase(ref.begin());
+            }
+            break;
+        }
+        case 3: {
+            std::optional<uint32_t> m = t.extract_max();
+            if (ref.empty()) bad += m.has_value();
+            else {
+                bad += !m || *m != *ref.rbegin();
+                ref.erase(std::prev(ref.end()));
+            }
+            break;
+        }
+        default: {
+            // a present key (or x itself) moved down to a smaller one
+            std::set<uint32_t>::iterator it = ref.lower_bound(x);
+            uint32_t from = (it == ref.end()) ? x : *it;
+            uint32_t to = (uint32_t)(rng() % ((uint64_t)from + 1));
+            bool ok = ref.count(from) == 1;
+            bad += t.decrease_key(from, to) != ok;
+            if (ok) {
+                ref.erase(from);
+                ref.insert(to);
+            }
+            break;
+        }
+        }
+        if (ref.empty()) bad += !t.empty();
+        else bad += !t.min() || *t.min() != *ref.begin() || !t.max() || *t.max() != *ref.rbegin();
+    }
+    while (!ref.empty()) {
+        bad += *t.extract_min() != *ref.begin();
+        ref.erase(ref.begin());
+    }
+    printf("Bits %u: mismatches %ld, heap blocks left %ld\n", Bits, bad, live_blocks - before);
+}
+
+// veb_tree의 extract / decrease_key를 std::set과 비교
+void testcase_template_extract() {
+    run_extract_against_set<6>(11);   // 0, 0
+    run_extract_against_set<12>(12);  // 0, 0
+    run_extract_against_set<24>(13);  // 0, 0
+}
+
+// priority_queue<Bits, Compare>를 std::multiset과 비교 (중복 키 포함)
+template <class Compare>
+static long run_queue_against_multiset(unsigned long long seed) {
+    const bool min_first = std::is_same<Compare, std::greater<uint32_t>>::value;
+    veb::priority_queue<10, Compare> q;
+    std::multiset<uint32_t> ref;
+    std::mt19937_64 rng(seed);
+    long bad = 0;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t x = (uint32_t)(rng() % 64);  // small range: many duplicates
+        switch (rng() % 4) {
+        case 0:
+        case 1:
+            q.push(x);
+            ref.insert(x);
+            break;
+        case 2:
+            if (!ref.empty()) {
+                std::multiset<uint32_t>::iterator top = min_first ? ref.begin() : std::prev(ref.end());
+                bad += q.top() != *top;
+                q.pop();
+                ref.erase(top);
+            }
+            break;
+        default: {
+            uint32_t y = (uint32_t)(rng() % (x + 1));
+            std::multiset<uint32_t>::iterator it = ref.find(x);
+            bad += q.decrease_key(x, y) != (it != ref.end());
+            if (it != ref.end()) {
+                ref.erase(it);
+                ref.insert(y);
+            }
+            break;
+        }
+        }
+        bad += q.size() != ref.size() || q.empty() != ref.empty();
+        if (!ref.empty()) bad += q.top() != (min_first ? *ref.begin() : *ref.rbegin());
+    }
+    return bad;
+}
+
+// 중복 키: 두 번 넣으면 두 번 꺼내야 함
+void testcase_priority_queue_duplicates() {
+    veb::priority_queue<16> q;  // std::less: 가장 큰 키가 top
+    q.push(5);
+    q.push(9);
+    q.push(5);
+    printf("Size: %zu, Top: %u\n", q.size(), q.top()); // 3, 9
+    q.pop();
+    printf("Pop, Top: %u, Size: %zu\n", q.top(), q.size()); // 5, 2
+    q.pop();
+    printf("Pop, Top: %u, Size: %zu\n", q.top(), q.size()); // 5, 1
+    q.pop();
+    printf("Pop, Empty? %d\n", q.empty()); // 1
+
+    veb::priority_queue<16, std::greater<uint32_t>> m;  // std::greater: 가장 작은 키가 top
+    m.push(7);
+    m.push(3);
+    m.push(7);
+    m.push(3);
+    printf("Greater order:");
+    while (!m.empty()) {
+        printf(" %u", m.top());
+        m.pop();
+    }
+    printf("\n"); // 3 3 7 7
+
+    // 중복 키 중 하나만 앞당기면 나머지 하나는 그대로 남음
+    m.push(10);
+    m.push(10);
+    bool moved = m.decrease_key(10, 4);
+    printf("Decrease 10 -> 4: %d, Top: %u\n", moved, m.top()); // 1, 4
+    m.pop();
+    printf("Pop, Top: %u, Size: %zu\n", m.top(), m.size()); // 10, 1
+    printf("Decrease absent 8: %d\n", m.decrease_key(8, 2)); // 0
+    printf("Decrease upward 10 -> 11: %d\n", m.decrease_key(10, 11)); // 0
+    printf("Queue vs multiset (less): %ld\n", run_queue_against_multiset<std::less<uint32_t>>(21)); // 0
+    printf("Queue vs multiset (greater): %ld\n", run_queue_against_multiset<std::greater<uint32_t>>(22)); // 0
+}
+
+int main() {
+    printf("\n======== testcase template vs std::set ========\n\n");
+    testcase_template_vs_set();
+    printf("\n======== testcase template release ========\n\n");
+    testcase_template_release();
+    printf("\n======== testcase template extract ========\n\n");
+    testcase_template_extract();
+    printf("\n======== testcase priority queue duplicates ========\n\n");
+    testcase_priority_queue_duplicates();
+
+    return 0;
+}
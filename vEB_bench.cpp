@@ -0,0 +1,419 @@
+// Benchmark harness for vEBTree.c
+//
+//   g++ -O2 -march=native -DNDEBUG -o vEB_bench vEB_bench.cpp -lm -lpthread
+//   ./vEB_bench [--quick] [--lg 16,20,24] [--keys N] [--dist uniform,zipf] [--only name]
+//
+// vEBTree.c is compiled into this file with VEB_NO_MAIN, so the builds of
+// the tests and of the benchmark stay separate. For every universe size,
+// key distribution and structure it reports create/free time, throughput
+// of insert, member, successor, predecessor and delete (ns/op), and
+// p50/p99/p99.9 latencies of member and successor measured one call at a
+// time. The contenders are the vEB variants (including the veb_tree<Bits>
+// template of vEBTree.hpp), std::set, a sorted array (built by sort, no
+// single-key delete) and a plain bitset.
+#define VEB_NO_MAIN
+#include "vEBTree.c"
+#include "vEBTree.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double seconds_since(bench_clock::time_point t0) {
+    return std::chrono::duration<double>(bench_clock::now() - t0).count();
+}
+
+static volatile uint64_t bench_sink; // keeps query results alive
+
+// KEY DISTRIBUTIONS
+// uniform:    independent keys over [0, U)
+// sequential: consecutive keys from a random start
+// clustered:  64 random centres, keys within U / 4096 of one of them
+// zipf:       ranks drawn with P(r) ~ 1 / r^0.99 over up to 2^20 items,
+//             scattered over [0, U) by an odd multiplier (a bijection)
+static const char* const bench_dists[] = { "uniform", "sequential", "clustered", "zipf" };
+
+struct KeyGen {
+    std::mt19937_64 rng;
+    uint64_t mask;
+    std::string dist;
+    uint64_t next_seq;
+    std::vector<uint64_t> centres;
+    std::vector<double> zipf_cdf;
+
+    KeyGen(const std::string& d, int lg, uint64_t seed) : rng(seed), dist(d) {
+        mask = (lg == 64) ? ~0ULL : (1ULL << lg) - 1;
+        next_seq = rng() & mask;
+        for (int i = 0; i < 64; i++) centres.push_back(rng() & mask);
+        if (dist == "zipf") {
+            size_t items = (size_t)std::min<uint64_t>(mask, 1 << 20) + 1;
+            zipf_cdf.resize(items);
+            double sum = 0;
+            for (size_t r = 0; r < items; r++) zipf_cdf[r] = (sum += 1.0 / std::pow((double)(r + 1), 0.99));
+            for (double& c : zipf_cdf) c /= sum;
+        }
+    }
+
+    uint64_t next() {
+        if (dist == "sequential") return next_seq++ & mask;
+        if (dist == "clustered") {
+            uint64_t width = (mask >> 12) + 1;
+            return (centres[rng() % centres.size()] + rng() % width) & mask;
+        }
+        if (dist == "zipf") {
+            double p = std::uniform_real_distribution<double>(0, 1)(rng);
+            uint64_t r = (uint64_t)(std::lower_bound(zipf_cdf.begin(), zipf_cdf.end(), p) - zipf_cdf.begin());
+            return (r * 0x9E3779B97F4A7C15ULL) & mask;
+        }
+        return rng() & mask;
+    }
+};
+
+// CONTENDERS
+// Each adapter exposes the same calls; succ/pred return -1 for "none".
+// max_lg bounds the universes a structure is run on (memory, int keys).
+struct Bench {
+    const char* name;
+    int max_lg;
+    virtual ~Bench() {}
+    virtual bool fits(int lg) { return lg <= max_lg; }
+    virtual void create(int lg) = 0;
+    virtual void destroy() = 0;
+    virtual void insert(uint64_t x) = 0;
+    virtual bool can_erase() { return true; }
+    virtual void erase(uint64_t x) = 0;
+    virtual int member(uint64_t x) = 0;
+    virtual int64_t succ(uint64_t x) = 0;
+    virtual int64_t pred(uint64_t x) = 0;
+    virtual void finish_inserts() {}
+};
+
+struct BenchVEB : Bench {
+    unsigned flags;
+    vEBNode* V;
+    BenchVEB(const char* n, unsigned f, int lg) : flags(f), V(NULL) { name = n; max_lg = lg; }
+    void create(int lg) { V = vEB_create_ex(1 << lg, flags); }
+    void destroy() { vEB_free(V); }
+    void insert(uint64_t x) { vEB_insert(V, (int)x); }
+    void erase(uint64_t x) { vEB_delete(V, (int)x); }
+    int member(uint64_t x) { return vEB_member(V, (int)x); }
+    int64_t succ(uint64_t x) { return vEB_successor(V, (int)x); }
+    int64_t pred(uint64_t x) { return vEB_predecessor(V, (int)x); }
+};
+
+struct BenchVEB64 : Bench {
+    unsigned flags;
+    vEB64Node* V;
+    BenchVEB64(const char* n, unsigned f, int lg) : flags(f), V(NULL) { name = n; max_lg = lg; }
+    void create(int lg) { V = vEB64_create_ex(lg, flags); }
+    void destroy() { vEB64_free(V); }
+    void insert(uint64_t x) { vEB64_insert(V, x); }
+    void erase(uint64_t x) { vEB64_delete(V, x); }
+    int member(uint64_t x) { return vEB64_member(V, x); }
+    int64_t succ(uint64_t x) { uint64_t y; return vEB64_successor(V, x, &y) ? (int64_t)y : -1; }
+    int64_t pred(uint64_t x) { uint64_t y; return vEB64_predecessor(V, x, &y) ? (int64_t)y : -1; }
+};
+
+// Keys only; each query also returns the stored value
+struct BenchMap : Bench {
+    vEBMap* M;
+    BenchMap() : M(NULL) { name = "vEBMap"; max_lg = 30; }
+    void create(int lg) { M = vEBMap_create(1 << lg); }
+    void destroy() { vEBMap_free(M); }
+    void insert(uint64_t x) { vEBMap_put(M, (int)x, NULL); }
+    void erase(uint64_t x) { vEBMap_delete(M, (int)x, NULL); }
+    int member(uint64_t x) { return vEBMap_get(M, (int)x, NULL); }
+    int64_t succ(uint64_t x) { void* v; return vEBMap_successor(M, (int)x, &v); }
+    int64_t pred(uint64_t x) { void* v; return vEBMap_predecessor(M, (int)x, &v); }
+};
+
+struct BenchCompact : Bench {
+    vEBCompact* C;
+    BenchCompact() : C(NULL) { name = "vEBCompact"; max_lg = 28; }
+    void create(int lg) { C = vEBCompact_create(1 << lg); }
+    void destroy() { vEBCompact_free(C); }
+    void insert(uint64_t x) { vEBCompact_insert(C, (int)x); }
+    void erase(uint64_t x) { vEBCompact_delete(C, (int)x); }
+    int member(uint64_t x) { return vEBCompact_member(C, (int)x); }
+    int64_t succ(uint64_t x) { return vEBCompact_successor(C, (int)x); }
+    int64_t pred(uint64_t x) { return vEBCompact_predecessor(C, (int)x); }
+};
+
+// Instantiated for one universe size only
+template <unsigned Bits>
+struct BenchTemplate : Bench {
+    veb::veb_tree<Bits>* T;
+    BenchTemplate() : T(NULL) { name = "veb_tree<Bits>"; max_lg = Bits; }
+    bool fits(int lg) { return lg == (int)Bits; }
+    void create(int) { T = new veb::veb_tree<Bits>(); }
+    void destroy() { delete T; }
+    void insert(uint64_t x) { T->insert((uint32_t)x); }
+    void erase(uint64_t x) { T->erase((uint32_t)x); }
+    int member(uint64_t x) { return T->contains((uint32_t)x); }
+    int64_t succ(uint64_t x) {
+        std::optional<uint32_t> y = T->successor((uint32_t)x);
+        return y ? (int64_t)*y : -1;
+    }
+    int64_t pred(uint64_t x) {
+        std::optional<uint32_t> y = T->predecessor((uint32_t)x);
+        return y ? (int64_t)*y : -1;
+    }
+};
+
+struct BenchStdSet : Bench {
+    std::set<uint64_t>* S;
+    BenchStdSet() : S(NULL) { name = "std::set"; max_lg = 64; }
+    void create(int) { S = new std::set<uint64_t>(); }
+    void destroy() { delete S; }
+    void insert(uint64_t x) { S->insert(x); }
+    void erase(uint64_t x) { S->erase(x); }
+    int member(uint64_t x) { return S->count(x) != 0; }
+    int64_t succ(uint64_t x) {
+        std::set<uint64_t>::iterator it = S->upper_bound(x);
+        return it == S->end() ? -1 : (int64_t)*it;
+    }
+    int64_t pred(uint64_t x) {
+        std::set<uint64_t>::iterator it = S->lower_bound(x);
+        return it == S->begin() ? -1 : (int64_t)*--it;
+    }
+};
+
+// Inserts are appended and sorted once in finish_inserts
+struct BenchSorted : Bench {
+    std::vector<uint64_t> a;
+    BenchSorted() { name = "sorted array"; max_lg = 64; }
+    void create(int) { a.clear(); }
+    void destroy() { std::vector<uint64_t>().swap(a); }
+    void insert(uint64_t x) { a.push_back(x); }
+    void finish_inserts() {
+        std::sort(a.begin(), a.end());
+        a.erase(std::unique(a.begin(), a.end()), a.end());
+    }
+    bool can_erase() { return false; }
+    void erase(uint64_t) {}
+    int member(uint64_t x) { return std::binary_search(a.begin(), a.end(), x); }
+    int64_t succ(uint64_t x) {
+        std::vector<uint64_t>::iterator it = std::upper_bound(a.begin(), a.end(), x);
+        return it == a.end() ? -1 : (int64_t)*it;
+    }
+    int64_t pred(uint64_t x) {
+        std::vector<uint64_t>::iterator it = std::lower_bound(a.begin(), a.end(), x);
+        return it == a.begin() ? -1 : (int64_t)*--it;
+    }
+};
+
+// One bit per key; successor/predecessor scan words
+struct BenchBitset : Bench {
+    std::vector<uint64_t> w;
+    uint64_t u;
+    BenchBitset() : u(0) { name = "bitset"; max_lg = 32; }
+    void create(int lg) { u = 1ULL << lg; w.assign((size_t)((u + 63) / 64), 0); }
+    void destroy() { std::vector<uint64_t>().swap(w); }
+    void insert(uint64_t x) { w[x >> 6] |= 1ULL << (x & 63); }
+    void erase(uint64_t x) { w[x >> 6] &= ~(1ULL << (x & 63)); }
+    int member(uint64_t x) { return (int)((w[x >> 6] >> (x & 63)) & 1); }
+    int64_t succ(uint64_t x) {
+        if (x + 1 >= u) return -1;
+        uint64_t i = (x + 1) >> 6, word = w[i] & (~0ULL << ((x + 1) & 63));
+        while (!word) {
+            if (++i == w.size()) return -1;
+            word = w[i];
+        }
+        return (int64_t)((i << 6) + __builtin_ctzll(word));
+    }
+    int64_t pred(uint64_t x) {
+        if (x == 0) return -1;
+        uint64_t i = (x - 1) >> 6, word = w[i] & (~0ULL >> (63 - ((x - 1) & 63)));
+        while (!word) {
+            if (i-- == 0) return -1;
+            word = w[i];
+        }
+        return (int64_t)((i << 6) + 63 - __builtin_clzll(word));
+    }
+};
+
+// MEASUREMENT
+struct BenchConfig {
+    std::vector<int> lgs;
+    std::vector<std::string> dists;
+    std::string only;
+    size_t keys;           // keys inserted (capped at U / 2)
+    size_t queries;        // queries per throughput run
+    size_t samples;        // single-call latency samples
+};
+
+static double percentile(std::vector<double>& v, double p) {
+    size_t i = (size_t)(p * (double)(v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + (long)i, v.end());
+    return v[i];
+}
+
+// ns per call of op over xs
+template <typename F>
+static double per_op(const std::vector<uint64_t>& xs, F op) {
+    bench_clock::time_point t0 = bench_clock::now();
+    uint64_t acc = 0;
+    for (size_t i = 0; i < xs.size(); i++) acc += (uint64_t)op(xs[i]);
+    double s = seconds_since(t0);
+    bench_sink += acc;
+    return s * 1e9 / (double)xs.size();
+}
+
+// p50/p99/p99.9 in ns of single calls of op
+template <typename F>
+static void latency(const std::vector<uint64_t>& xs, size_t samples, F op, double out[3]) {
+    std::vector<double> ns;
+    ns.reserve(samples);
+    uint64_t acc = 0;
+    for (size_t i = 0; i < samples; i++) {
+        bench_clock::time_point t0 = bench_clock::now();
+        acc += (uint64_t)op(xs[i % xs.size()]);
+        ns.push_back(std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count());
+    }
+    bench_sink += acc;
+    out[0] = percentile(ns, 0.50);
+    out[1] = percentile(ns, 0.99);
+    out[2] = percentile(ns, 0.999);
+}
+
+static void run_one(Bench* B, int lg, const std::string& dist, const BenchConfig& cfg) {
+    uint64_t u = (lg >= 64) ? ~0ULL : 1ULL << lg;  // 2^64 - 1 keys for lg = 64
+    size_t n = (size_t)std::min<uint64_t>(cfg.keys, u / 2);
+    KeyGen gen(dist, lg, 42);
+    std::vector<uint64_t> keys(n), queries(cfg.queries);
+    for (size_t i = 0; i < n; i++) keys[i] = gen.next();
+    KeyGen qgen(dist, lg, 43);
+    for (size_t i = 0; i < cfg.queries; i++) queries[i] = qgen.next();
+
+    bench_clock::time_point t0 = bench_clock::now();
+    B->create(lg);
+    double create_ms = seconds_since(t0) * 1e3;
+
+    t0 = bench_clock::now();
+    for (size_t i = 0; i < n; i++) B->insert(keys[i]);
+    B->finish_inserts();
+    double ins = seconds_since(t0) * 1e9 / (double)n;
+
+    double mem = per_op(queries, [B](uint64_t x) { return B->member(x); });
+    double suc = per_op(queries, [B](uint64_t x) { return B->succ(x); });
+    double pre = per_op(queries, [B](uint64_t x) { return B->pred(x); });
+    double lat_m[3], lat_s[3];
+    latency(queries, cfg.samples, [B](uint64_t x) { return B->member(x); }, lat_m);
+    latency(queries, cfg.samples, [B](uint64_t x) { return B->succ(x); }, lat_s);
+
+    char del[16] = "-";
+    if (B->can_erase()) {
+        t0 = bench_clock::now();
+        for (size_t i = 0; i < n; i++) B->erase(keys[i]);
+        snprintf(del, sizeof(del), "%.1f", seconds_since(t0) * 1e9 / (double)n);
+    }
+
+    t0 = bench_clock::now();
+    B->destroy();
+    double free_ms = seconds_since(t0) * 1e3;
+
+    printf("%-2d %-10s %-18s %9.2f %9.2f %8.1f %8s %8.1f %8.1f %8.1f  %6.0f/%6.0f/%6.0f  %6.0f/%6.0f/%6.0f\n",
+           lg, dist.c_str(), B->name, create_ms, free_ms, ins, del, mem, suc, pre,
+           lat_m[0], lat_m[1], lat_m[2], lat_s[0], lat_s[1], lat_s[2]);
+    fflush(stdout);
+}
+
+static std::vector<std::string> split_list(const char* s) {
+    std::vector<std::string> out;
+    std::string cur;
+    for (; ; s++) {
+        if (*s == ',' || *s == '\0') {
+            if (!cur.empty()) out.push_back(cur);
+            cur.clear();
+            if (*s == '\0') break;
+        }
+        else {
+            cur += *s;
+        }
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    cfg.lgs = { 16, 20, 24, 28, 32 };
+    cfg.dists.assign(bench_dists, bench_dists + 4);
+    cfg.keys = 1 << 20;
+    cfg.queries = 1 << 20;
+    cfg.samples = 100000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick")) {
+            cfg.lgs = { 16, 20 };
+            cfg.keys = cfg.queries = 1 << 16;
+            cfg.samples = 10000;
+        }
+        else if (!strcmp(argv[i], "--lg") && i + 1 < argc) {
+            cfg.lgs.clear();
+            for (const std::string& s : split_list(argv[++i])) {
+                int lg = atoi(s.c_str());
+                if (lg < 1 || lg > 64) {
+                    fprintf(stderr, "--lg %s: must be in [1, 64]\n", s.c_str());
+                    return 1;
+                }
+                cfg.lgs.push_back(lg);
+            }
+        }
+        else if (!strcmp(argv[i], "--keys") && i + 1 < argc) {
+            cfg.keys = cfg.queries = (size_t)strtoull(argv[++i], NULL, 10);
+        }
+        else if (!strcmp(argv[i], "--dist") && i + 1 < argc) {
+            cfg.dists = split_list(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--only") && i + 1 < argc) {
+            cfg.only = argv[++i];
+        }
+        else {
+            fprintf(stderr, "usage: %s [--quick] [--lg 16,20,...] [--keys N] [--dist uniform,sequential,clustered,zipf] [--only name]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.keys == 0) cfg.keys = cfg.queries = 1;
+
+    std::vector<Bench*> all;
+    // eager trees allocate O(U) nodes, so they only run on small universes
+    all.push_back(new BenchVEB("vEB eager", 0, 20));
+    all.push_back(new BenchVEB("vEB eager+bitmap", VEB_BITMAP_LEAVES, 24));
+    all.push_back(new BenchVEB("vEB lazy+bitmap", VEB_LAZY | VEB_BITMAP_LEAVES, 30));
+    all.push_back(new BenchVEB("vEB hashed+bitmap", VEB_LAZY | VEB_HASHED | VEB_BITMAP_LEAVES, 30));
+    all.push_back(new BenchCompact());
+    all.push_back(new BenchMap());
+    all.push_back(new BenchTemplate<16>());
+    all.push_back(new BenchTemplate<20>());
+    all.push_back(new BenchTemplate<24>());
+    all.push_back(new BenchTemplate<28>());
+    all.push_back(new BenchTemplate<32>());
+    // dense cluster arrays have 2^(lg/2) slots at the root (32 GiB at lg = 64)
+    all.push_back(new BenchVEB64("vEB64", 0, 48));
+    all.push_back(new BenchVEB64("vEB64 hashed", VEB_HASHED, 64));
+    all.push_back(new BenchStdSet());
+    all.push_back(new BenchSorted());
+    all.push_back(new BenchBitset());
+
+    printf("%-2s %-10s %-18s %9s %9s %8s %8s %8s %8s %8s  %-20s  %-20s\n",
+           "lg", "dist", "structure", "create ms", "free ms", "insert", "delete", "member", "succ", "pred",
+           "member p50/p99/p999", "succ p50/p99/p999");
+    for (int lg : cfg.lgs) {
+        for (const std::string& dist : cfg.dists) {
+            for (Bench* B : all) {
+                if (!B->fits(lg)) continue;
+                if (!cfg.only.empty() && cfg.only != B->name) continue;
+                run_one(B, lg, dist, cfg);
+            }
+        }
+    }
+    for (Bench* B : all) delete B;
+    return 0;
+}